@@ -0,0 +1,211 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "smokers.h"
+
+// function to record how long the last released round took to reach the agent
+static void record_rewake(struct shared_mem *mem, uint64_t wake_ns, uint64_t *last_release) {
+    uint64_t release = atomic_load(&mem->release_ns);
+    if (release == 0 || release == *last_release) { // no new release since the previous wake
+        return;
+    }
+    *last_release = release;
+    hist_record(&mem->hist[LAT_RETURN], wake_ns - release);
+    hist_record(&mem->hist[LAT_ROUND], wake_ns - atomic_load(&mem->release_posted_ns));
+}
+
+// function to free the slot of a smoker which exited without leaving: post back the agent tokens of the deliveries
+// it held, taken or not, and hand back the rounds it did not smoke, returns their number so they are published again
+static int reclaim_slot(struct schedule *schedule, int i) {
+    struct shared_mem *mem = schedule->mem;
+    struct mailbox *box = mem_mailbox(mem, i);
+    uint64_t posted = schedule->posted[i];
+    uint64_t lost = posted - atomic_load(&box->served) - atomic_load(&box->returned);
+    for (uint64_t r = atomic_load(&box->released); !pull && r < posted; r++) { // with --pull it held no token
+        if (backend->post(AGENT_SEM(mem)) == -1) {
+            exit(1);
+        }
+    }
+    atomic_fetch_add(&box->returned, lost);
+    atomic_store(&box->taken, posted); // the next smoker of the slot starts at the next delivery
+    atomic_store(&box->released, posted);
+    clear_ready(mem, i);
+    atomic_store(&box->owner, 0);
+    atomic_store(&box->state, SLOT_FREE);
+    printf("Smoker %d exited without leaving, %lu round(s) handed back.\n", i, (unsigned long) lost);
+    fflush(stdout);
+    return (int) lost;
+}
+
+// function to follow smokers joining and leaving: retire smokers which asked to leave, free the slots of dead ones
+// and rebuild the schedule, returns the number of rounds the dead ones handed back
+static int update_members(struct schedule *schedule) {
+    struct shared_mem *mem = schedule->mem;
+    int lost = 0;
+    for (int i = 0; i < mem->smokers; i++) { // loop through slots
+        struct mailbox *box = mem_mailbox(mem, i);
+        int state = atomic_load(&box->state);
+        if (state == SLOT_LEAVING) { // no more rounds, wake it once all posted ones are taken
+            box->retire_at = schedule->posted[i];
+            atomic_store(&box->state, SLOT_RETIRED);
+            clear_ready(mem, i);
+            backend->post(SMOKER_SEM(mem, i));
+        } else if (state == SLOT_DEAD) {
+            lost += reclaim_slot(schedule, i);
+        }
+    }
+    schedule_update(schedule);
+    return lost;
+}
+
+// function to consume a post of the watchdog, returns 0 if the wake came from a round or an idle smoker instead
+static int take_wakeup(struct shared_mem *mem) {
+    if (!watchdog || atomic_load_explicit(&mem->wakeups, memory_order_relaxed) == 0) {
+        return 0;
+    }
+    atomic_fetch_sub(&mem->wakeups, 1); // only the agent takes them
+    return 1;
+}
+
+// function to end the rounds of a table: wait for the rounds in flight, then wake every smoker to terminate
+// returns the number of rounds smokers which died meanwhile handed back, the table is not finished then
+static int finish(struct schedule *schedule) {
+    struct shared_mem *mem = schedule->mem;
+    int lost = 0;
+    if (pull) { // every round in flight posts the agent once its smoker is idle again
+        while (lost == 0 && schedule_in_flight(schedule) > 0) {
+            if (sync_wait(AGENT_SEM(mem)) == -1) {
+                exit(1);
+            }
+            if (take_wakeup(mem)) {
+                lost = update_members(schedule);
+            }
+        }
+        for (int i = 0; lost > 0 && i < mem->smokers; i++) { // post again for the idle smokers the waits consumed
+            if (is_ready(mem, i) && backend->post(AGENT_SEM(mem)) == -1) {
+                exit(1);
+            }
+        }
+    } else if (!watchdog) {
+        if (sync_wait_batch(AGENT_SEM(mem), mem->depth - 1) == -1) { // wait until smokers drain the other rounds
+            exit(1);
+        }
+    } else { // one token at a time, a smoker may die holding some
+        int held = 1; // the token of the wake which found every round published
+        while (lost == 0 && held < mem->depth) {
+            if (sync_wait(AGENT_SEM(mem)) == -1) {
+                exit(1);
+            }
+            if (take_wakeup(mem)) {
+                lost = update_members(schedule);
+            } else {
+                held++;
+            }
+        }
+        for (int i = 0; lost > 0 && i < held; i++) { // publish the handed back rounds with them
+            if (backend->post(AGENT_SEM(mem)) == -1) {
+                exit(1);
+            }
+        }
+    }
+    if (lost > 0) {
+        return lost;
+    }
+    mem->finish_ns = now_ns();
+    log_event(LOG_AGENT, EV_DONE, mem->index, 0, 0, 0);
+    mem->done = 1; // tell smokers to terminate
+    int *smoker_sems = calloc(mem->smokers, sizeof(int)); // semaphores woken together
+    if (smoker_sems == NULL) {
+        perror("calloc");
+        exit(1);
+    }
+    int woken = 0;
+    for (int i = 0; i < mem->smokers; i++) { // every slot which has a smoker
+        if (atomic_load(&mem_mailbox(mem, i)->state) != SLOT_FREE) {
+            smoker_sems[woken++] = SMOKER_SEM(mem, i);
+        }
+    }
+    sync_post_batch(smoker_sems, woken, 1); // wake up every smoker
+    free(smoker_sems);
+    return 0;
+}
+
+// function to simulate the agent process
+// the agent semaphore counts rounds which may still be published, so up to depth rounds are in flight at once;
+// with --pull it counts smokers which became idle instead, and every idle smoker may have a round at once
+void agent(struct shared_mem *mem) {
+    int depth = mem->depth;
+    int items = mem->items;
+    uint64_t all = items == 64 ? ~0ULL : (1ULL << items) - 1; // mask of every item
+    uint64_t last_release = 0; // release_ns seen by the previous wake
+    struct trace_buffer *trace = mem_trace(mem, mem->smokers); // steps of the agent with --trace
+    struct schedule schedule; // smokers the policy chooses from
+    if (schedule_init(&schedule, mem) == -1) {
+        exit(1);
+    }
+    uint32_t members = atomic_load(&mem->members); // membership the schedule was built for
+    update_members(&schedule);
+    struct timespec idle = {0, 1000000}; // 1 ms between checks while no smoker is active
+    int round = 0;
+    note_setup_done();
+    while (1) {
+        trace_step(trace, TR_WAIT, round, 0);
+        if (sync_wait(AGENT_SEM(mem)) == -1) { // wait until a round may be published or, with --pull, a smoker is idle
+            exit(1);
+        }
+        trace_step(trace, TR_WAKE, round, 0);
+        if (bench) {
+            record_rewake(mem, now_ns(), &last_release);
+        }
+        if (take_wakeup(mem)) { // a post of the watchdog, not a round: free the slots of dead smokers
+            members = atomic_load(&mem->members);
+            round -= update_members(&schedule);
+            continue;
+        }
+        if (round >= max_rounds) { // check if maximum rounds reached
+            int lost = finish(&schedule);
+            if (lost > 0) { // publish the rounds of smokers which died meanwhile
+                round -= lost;
+                continue;
+            }
+            schedule_free(&schedule);
+            spin_flush(&mem->spin);
+            return;
+        }
+        while (1) { // one load per round unless smokers joined or left
+            if (atomic_load(&mem->members) != members) {
+                members = atomic_load(&mem->members);
+                round -= update_members(&schedule);
+            }
+            if (schedule.nactive > 0) {
+                break;
+            }
+            nanosleep(&idle, NULL); // wait for a smoker to join
+        }
+        int smoker_index = policy->pick(&schedule); // next smoker
+        if (smoker_index == -1) { // --pull and the post came from a smoker which is gone or already has a round
+            continue;
+        }
+        if (pull) {
+            clear_ready(mem, smoker_index);
+        }
+        if (deadline_set && deadline_missed(&schedule, smoker_index, now_ns())) {
+            mem->deadline_misses++;
+        }
+        uint64_t table = all & ~(1ULL << schedule.item[smoker_index]); // every item but the one the smoker has
+        log_event(LOG_AGENT, EV_PUT, mem->index, 0, 0, table);
+        // deliver the items straight into the mailbox of the smoker, no other cache line is written
+        uint64_t *posted = &schedule.posted[smoker_index];
+        struct delivery *delivery = &mailbox_ring(mem, mem_mailbox(mem, smoker_index))[*posted % depth];
+        delivery->table = table;
+        delivery->round = round;
+        delivery->posted_ns = bench ? now_ns() : 0;
+        atomic_store_explicit(&delivery->seq, (*posted)++, memory_order_release);
+        if (backend->post(SMOKER_SEM(mem, smoker_index)) == -1) { // signal the smoker semaphore
+            exit(1);
+        }
+        trace_step(trace, TR_POST, round++, smoker_index);
+    }
+}
@@ -0,0 +1,62 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "smokers.h"
+
+// table of all available backends
+const struct sync_backend *const backends[] = {
+    &posix_unnamed_backend,
+    &posix_named_backend,
+    &sysv_backend,
+    &futex_backend,
+    &condvar_backend,
+    &eventfd_backend,
+};
+
+// number of backends
+const int nbackends = sizeof(backends) / sizeof(backends[0]);
+
+// function to find a backend by name, returns NULL if there is none
+const struct sync_backend *find_backend(const char *name) {
+    for (int i = 0; i < nbackends; i++) { // loop through backends
+        if (strcmp(backends[i]->name, name) == 0) { // compare names
+            return backends[i];
+        }
+    }
+    return NULL;
+}
+
+// function to print the names of all backends separated by '|'
+void print_backend_names(void) {
+    for (int i = 0; i < nbackends; i++) { // loop through backends
+        printf("%s%s", i ? "|" : "", backends[i]->name);
+    }
+}
+
+// function to add value to count semaphores, in one call if the backend supports batches
+int sync_post_batch(const int *sems, int count, int value) {
+    if (backend->post_batch != NULL) {
+        return backend->post_batch(sems, count, value);
+    }
+    for (int i = 0; i < count; i++) { // one post per semaphore and unit
+        for (int j = 0; j < value; j++) {
+            if (backend->post(sems[i]) == -1) {
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+// function to subtract value from a semaphore, in one call if the backend supports batches
+int sync_wait_batch(int sem, int value) {
+    if (backend->wait_batch != NULL) {
+        return backend->wait_batch(sem, value);
+    }
+    for (int i = 0; i < value; i++) { // one wait per unit
+        if (backend->wait(sem) == -1) {
+            return -1;
+        }
+    }
+    return 0;
+}
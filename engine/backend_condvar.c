@@ -0,0 +1,175 @@
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include "smokers.h"
+
+// counting semaphore built from a mutex and a condition variable
+struct cond_sem {
+    pthread_mutex_t mutex; // protects value
+    pthread_cond_t cond; // signalled when value becomes positive
+    unsigned int value; // semaphore value
+};
+
+// mutexes and condition variables placed in the shared memory area, stride bytes apart
+struct condvar_area {
+    size_t stride; // distance between semaphores
+    _Alignas(CACHE_LINE) unsigned char sems[];
+};
+
+static struct condvar_area *shared; // area in shared memory
+static int count; // number of semaphores
+
+// function to get a semaphore in the area
+static struct cond_sem *condvar_sem(int sem) {
+    return (struct cond_sem *) (shared->sems + sem * shared->stride);
+}
+
+// function to get the size of the area for nsems semaphores
+static size_t condvar_area_size(int nsems) {
+    return sizeof(struct condvar_area) + nsems * sem_stride(sizeof(struct cond_sem));
+}
+
+// function to initialize the semaphores, process-shared unless the group runs as threads
+// mutexes are robust, so a smoker killed while holding one does not block the agent forever
+static int condvar_create(void *area, int nsems) {
+    int pshared = threads ? PTHREAD_PROCESS_PRIVATE : PTHREAD_PROCESS_SHARED;
+    pthread_mutexattr_t mutex_attr;
+    pthread_condattr_t cond_attr;
+    shared = area;
+    shared->stride = sem_stride(sizeof(struct cond_sem));
+    count = nsems;
+    pthread_mutexattr_init(&mutex_attr);
+    pthread_mutexattr_setpshared(&mutex_attr, pshared);
+    pthread_mutexattr_setrobust(&mutex_attr, PTHREAD_MUTEX_ROBUST);
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setpshared(&cond_attr, pshared);
+    for (int i = 0; i < nsems; i++) { // loop through semaphores
+        struct cond_sem *s = condvar_sem(i);
+        int error = pthread_mutex_init(&s->mutex, &mutex_attr);
+        if (error == 0) {
+            error = pthread_cond_init(&s->cond, &cond_attr);
+        }
+        if (error != 0) { // check for errors
+            fprintf(stderr, "pthread_init: %s\n", strerror(error));
+            return -1;
+        }
+        s->value = 0;
+    }
+    pthread_mutexattr_destroy(&mutex_attr);
+    pthread_condattr_destroy(&cond_attr);
+    return 0;
+}
+
+// function to attach to semaphores which already live in the area
+static int condvar_attach(void *area, int nsems) {
+    shared = area;
+    count = nsems;
+    return 0;
+}
+
+// function to take over the mutex of a process which died holding it, value is only changed by single stores
+static int condvar_recovered(struct cond_sem *s, int error, const char *call) {
+    if (error == EOWNERDEAD) {
+        error = pthread_mutex_consistent(&s->mutex);
+        call = "pthread_mutex_consistent";
+    }
+    if (error != 0) { // check for errors
+        fprintf(stderr, "%s: %s\n", call, strerror(error));
+        return -1;
+    }
+    return 0;
+}
+
+// function to lock the mutex of a semaphore
+static int condvar_lock(struct cond_sem *s) {
+    return condvar_recovered(s, pthread_mutex_lock(&s->mutex), "pthread_mutex_lock");
+}
+
+// function to unlock the mutex of a semaphore
+static int condvar_unlock(struct cond_sem *s) {
+    int error = pthread_mutex_unlock(&s->mutex);
+    if (error != 0) { // check for errors
+        fprintf(stderr, "pthread_mutex_unlock: %s\n", strerror(error));
+        return -1;
+    }
+    return 0;
+}
+
+// function to wait for a semaphore
+static int condvar_wait(int sem) {
+    struct cond_sem *s = condvar_sem(sem);
+    if (condvar_lock(s) == -1) {
+        return -1;
+    }
+    while (s->value == 0) { // guard against spurious wake-ups
+        if (condvar_recovered(s, pthread_cond_wait(&s->cond, &s->mutex), "pthread_cond_wait") == -1) {
+            return -1; // the mutex is not held after an error
+        }
+    }
+    s->value--;
+    return condvar_unlock(s);
+}
+
+// function to signal a semaphore
+static int condvar_post(int sem) {
+    struct cond_sem *s = condvar_sem(sem);
+    if (condvar_lock(s) == -1) {
+        return -1;
+    }
+    s->value++;
+    int error = pthread_cond_signal(&s->cond);
+    if (error != 0) { // check for errors
+        fprintf(stderr, "pthread_cond_signal: %s\n", strerror(error));
+        condvar_unlock(s);
+        return -1;
+    }
+    return condvar_unlock(s);
+}
+
+// function to repair a semaphore whose only waiter was killed, possibly inside pthread_cond_wait:
+// the condition variable still counts the dead waiter, so it is initialized again while the mutex is held
+static int condvar_recover(int sem) {
+    struct cond_sem *s = condvar_sem(sem);
+    pthread_condattr_t cond_attr;
+    if (condvar_lock(s) == -1) {
+        return -1;
+    }
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setpshared(&cond_attr, threads ? PTHREAD_PROCESS_PRIVATE : PTHREAD_PROCESS_SHARED);
+    int error = pthread_cond_init(&s->cond, &cond_attr);
+    pthread_condattr_destroy(&cond_attr);
+    if (error != 0) { // check for errors
+        fprintf(stderr, "pthread_cond_init: %s\n", strerror(error));
+        condvar_unlock(s);
+        return -1;
+    }
+    return condvar_unlock(s);
+}
+
+// function to read the value of a semaphore without its mutex, a sample may be one update old
+static int condvar_value(int sem) {
+    return (int) __atomic_load_n(&condvar_sem(sem)->value, __ATOMIC_RELAXED);
+}
+
+// function to destroy the mutexes and condition variables
+static void condvar_destroy(void) {
+    for (int i = 0; i < count; i++) { // loop through semaphores
+        pthread_cond_destroy(&condvar_sem(i)->cond);
+        pthread_mutex_destroy(&condvar_sem(i)->mutex);
+    }
+}
+
+const struct sync_backend condvar_backend = {
+    .name = "condvar",
+    .variants = "-",
+    .area_size = condvar_area_size,
+    .create = condvar_create,
+    .attach = condvar_attach,
+    .value = condvar_value,
+    .wait = condvar_wait,
+    .post = condvar_post,
+    .recover = condvar_recover,
+    .destroy = condvar_destroy,
+};
@@ -0,0 +1,117 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+
+#include "smokers.h"
+
+static int *fds; // one eventfd per semaphore, inherited by forked children
+static int count; // number of semaphores
+
+// function to get the size of the area, descriptors live in process memory
+static size_t eventfd_area_size(int nsems) {
+    return 0;
+}
+
+// function to raise the descriptor limit to the hard limit if nsems descriptors do not fit
+static void raise_fd_limit(int nsems) {
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < (rlim_t) nsems + 64) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+// function to create nsems eventfds in semaphore mode, every read takes one unit
+static int eventfd_create(void *area, int nsems) {
+    raise_fd_limit(nsems);
+    fds = calloc(nsems, sizeof(int));
+    if (fds == NULL) {
+        perror("calloc");
+        return -1;
+    }
+    for (count = 0; count < nsems; count++) { // loop through semaphores
+        fds[count] = eventfd(0, EFD_SEMAPHORE | EFD_NONBLOCK); // several workers may race for one unit
+        if (fds[count] == -1) { // check for errors
+            perror("eventfd");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// function to attach to eventfds, forked children already hold the descriptors
+static int eventfd_attach(void *area, int nsems) {
+    return 0;
+}
+
+// function to take one unit without blocking
+static int eventfd_try_wait(int sem) {
+    uint64_t value;
+    while (read(fds[sem], &value, sizeof(value)) == -1) {
+        if (errno == EAGAIN) { // semaphore is 0
+            return 0;
+        }
+        if (errno != EINTR) { // retry if interrupted by a signal
+            perror("read");
+            return -1;
+        }
+    }
+    return 1;
+}
+
+// function to wait for a semaphore
+static int eventfd_wait(int sem) {
+    struct pollfd pfd = {fds[sem], POLLIN, 0};
+    int result;
+    while ((result = eventfd_try_wait(sem)) == 0) { // sleep until a unit may be available
+        if (poll(&pfd, 1, -1) == -1 && errno != EINTR) { // check for errors
+            perror("poll");
+            return -1;
+        }
+    }
+    return result == 1 ? 0 : -1;
+}
+
+// function to signal a semaphore
+static int eventfd_post(int sem) {
+    uint64_t one = 1;
+    while (write(fds[sem], &one, sizeof(one)) == -1) { // retry if interrupted by a signal
+        if (errno != EINTR) {
+            perror("write");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// function to get the descriptor of a semaphore for epoll
+static int eventfd_wait_fd(int sem) {
+    return fds[sem];
+}
+
+// function to close the eventfds
+static void eventfd_destroy(void) {
+    for (int i = 0; i < count; i++) { // loop through semaphores
+        close(fds[i]);
+    }
+    free(fds);
+    fds = NULL;
+    count = 0;
+}
+
+const struct sync_backend eventfd_backend = {
+    .name = "eventfd",
+    .variants = "-",
+    .area_size = eventfd_area_size,
+    .create = eventfd_create,
+    .attach = eventfd_attach,
+    .wait = eventfd_wait,
+    .post = eventfd_post,
+    .wait_fd = eventfd_wait_fd,
+    .try_wait = eventfd_try_wait,
+    .destroy = eventfd_destroy,
+};
@@ -0,0 +1,143 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "smokers.h"
+
+// counting semaphore built on a 32-bit futex word in shared memory
+struct futex_sem {
+    _Atomic uint32_t value; // semaphore value, also the futex word
+    _Atomic uint32_t waiters; // number of processes parked in FUTEX_WAIT
+};
+
+// state shared between processes
+struct futex_area {
+    _Atomic unsigned long wait_calls; // FUTEX_WAIT syscalls made by all processes
+    _Atomic unsigned long wake_calls; // FUTEX_WAKE syscalls made by all processes
+    size_t stride; // distance between semaphores
+    _Alignas(CACHE_LINE) unsigned char sems[]; // one semaphore per smoker plus the agent
+};
+
+static struct futex_area *shared; // area in shared memory
+
+// function to get a semaphore in the area
+static struct futex_sem *futex_sem(int sem) {
+    return (struct futex_sem *) (shared->sems + sem * shared->stride);
+}
+
+// function to call the futex syscall, words are process-private when the group runs as threads
+static long futex(_Atomic uint32_t *word, int op, uint32_t value) {
+    return syscall(SYS_futex, word, threads ? op | FUTEX_PRIVATE_FLAG : op, value, NULL, NULL, 0);
+}
+
+// function to get the size of the area
+static size_t futex_area_size(int nsems) {
+    return sizeof(struct futex_area) + nsems * sem_stride(sizeof(struct futex_sem));
+}
+
+// function to initialize futex words to 0
+static int futex_create(void *area, int nsems) {
+    shared = area;
+    atomic_init(&shared->wait_calls, 0);
+    atomic_init(&shared->wake_calls, 0);
+    shared->stride = sem_stride(sizeof(struct futex_sem));
+    for (int i = 0; i < nsems; i++) { // loop through semaphores
+        atomic_init(&futex_sem(i)->value, 0);
+        atomic_init(&futex_sem(i)->waiters, 0);
+    }
+    return 0;
+}
+
+// function to attach to futex words which already live in the area
+static int futex_attach(void *area, int nsems) {
+    shared = area;
+    return 0;
+}
+
+// function to read the value of a semaphore, the futex word
+static int futex_value(int sem) {
+    return (int) atomic_load_explicit(&futex_sem(sem)->value, memory_order_relaxed);
+}
+
+// function to take one unit if the value is positive, returns 1 on success
+static int futex_try_take(struct futex_sem *s) {
+    uint32_t value = atomic_load_explicit(&s->value, memory_order_relaxed);
+    while (value > 0) { // value is reloaded by a failed compare-exchange
+        if (atomic_compare_exchange_weak_explicit(&s->value, &value, value - 1,
+                                                  memory_order_acquire, memory_order_relaxed)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// function to wait for a semaphore: one atomic when a unit is available, FUTEX_WAIT otherwise
+static int futex_wait(int sem) {
+    struct futex_sem *s = futex_sem(sem);
+    if (futex_try_take(s)) { // fast path
+        return 0;
+    }
+    atomic_fetch_add(&s->waiters, 1); // announce that a waiter may park
+    while (!futex_try_take(s)) {
+        atomic_fetch_add_explicit(&shared->wait_calls, 1, memory_order_relaxed);
+        // sleep only while the value is still 0, the kernel rechecks it atomically
+        if (futex(&s->value, FUTEX_WAIT, 0) == -1 && errno != EAGAIN && errno != EINTR) {
+            perror("futex");
+            atomic_fetch_sub(&s->waiters, 1);
+            return -1;
+        }
+    }
+    atomic_fetch_sub(&s->waiters, 1);
+    return 0;
+}
+
+// function to take one unit without blocking
+static int futex_try_wait(int sem) {
+    return futex_try_take(futex_sem(sem));
+}
+
+// function to signal a semaphore: FUTEX_WAKE is called only when somebody is parked
+static int futex_post(int sem) {
+    struct futex_sem *s = futex_sem(sem);
+    atomic_fetch_add(&s->value, 1); // sequentially consistent, ordered before the waiters load
+    if (atomic_load(&s->waiters) > 0) { // slow path
+        atomic_fetch_add_explicit(&shared->wake_calls, 1, memory_order_relaxed);
+        if (futex(&s->value, FUTEX_WAKE, 1) == -1) {
+            perror("futex");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// function to print the number of futex syscalls per round
+static void futex_report(int rounds) {
+    unsigned long waits = atomic_load(&shared->wait_calls);
+    unsigned long wakes = atomic_load(&shared->wake_calls);
+    printf("futex: %lu FUTEX_WAIT and %lu FUTEX_WAKE calls, %.2f syscalls per round.\n",
+           waits, wakes, rounds > 0 ? (double) (waits + wakes) / rounds : 0.0);
+}
+
+// function to destroy futex semaphores, nothing is allocated outside of shared memory
+static void futex_destroy(void) {
+}
+
+const struct sync_backend futex_backend = {
+    .name = "futex",
+    .variants = "-",
+    .area_size = futex_area_size,
+    .create = futex_create,
+    .attach = futex_attach,
+    .wait = futex_wait,
+    .post = futex_post,
+    .try_wait = futex_try_wait,
+    .cheap_try_wait = 1,
+    .value = futex_value,
+    .report = futex_report,
+    .destroy = futex_destroy,
+};
@@ -0,0 +1,121 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <semaphore.h>
+
+#include "smokers.h"
+
+// state shared between processes: names are derived from the creator pid
+struct named_area {
+    pid_t owner; // pid of the process which created the semaphores
+};
+
+static struct named_area *shared; // area in shared memory
+static sem_t **sems; // semaphores opened in this process
+static int count; // number of semaphores
+
+// function to format the name of a semaphore
+static void named_sem_name(char *name, size_t size, int sem) {
+    snprintf(name, size, "/smokers.%d.%d", (int) shared->owner, sem);
+}
+
+// function to get the size of the area
+static size_t named_area_size(int nsems) {
+    return sizeof(struct named_area);
+}
+
+// function to open every semaphore with the given flags
+static int named_open_all(int oflag) {
+    sems = calloc(count, sizeof(sem_t *)); // allocate array of semaphore pointers
+    if (sems == NULL) {
+        perror("calloc");
+        return -1;
+    }
+    for (int i = 0; i < count; i++) { // loop through semaphores
+        char name[32]; // buffer for semaphore name
+        named_sem_name(name, sizeof(name), i);
+        sems[i] = sem_open(name, oflag, 0666, 0); // open semaphore with initial value 0
+        if (sems[i] == SEM_FAILED) { // check for errors
+            perror("sem_open");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// function to create named semaphores
+static int named_create(void *area, int nsems) {
+    shared = area;
+    shared->owner = getpid();
+    count = nsems;
+    return named_open_all(O_CREAT | O_EXCL);
+}
+
+// function to open named semaphores created by another process
+static int named_attach(void *area, int nsems) {
+    shared = area;
+    count = nsems;
+    if (sems != NULL) { // already opened before fork
+        return 0;
+    }
+    return named_open_all(0);
+}
+
+// function to wait for a semaphore
+static int named_wait(int sem) {
+    while (sem_wait(sems[sem]) == -1) { // retry if interrupted by a signal
+        if (errno != EINTR) {
+            perror("sem_wait");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// function to take one unit without blocking, sem_trywait stays in user space
+static int named_try_wait(int sem) {
+    if (sem_trywait(sems[sem]) == 0) {
+        return 1;
+    }
+    if (errno == EAGAIN || errno == EINTR) { // semaphore is 0
+        return 0;
+    }
+    perror("sem_trywait");
+    return -1;
+}
+
+// function to signal a semaphore
+static int named_post(int sem) {
+    if (sem_post(sems[sem]) == -1) { // check for errors
+        perror("sem_post");
+        return -1;
+    }
+    return 0;
+}
+
+// function to close and unlink named semaphores
+static void named_destroy(void) {
+    for (int i = 0; i < count; i++) { // loop through semaphores
+        char name[32]; // buffer for semaphore name
+        named_sem_name(name, sizeof(name), i);
+        sem_close(sems[i]); // close semaphore
+        sem_unlink(name); // unlink semaphore
+    }
+    free(sems);
+    sems = NULL;
+}
+
+const struct sync_backend posix_named_backend = {
+    .name = "posix-named",
+    .variants = "mod_5, mod_8",
+    .area_size = named_area_size,
+    .create = named_create,
+    .attach = named_attach,
+    .wait = named_wait,
+    .post = named_post,
+    .try_wait = named_try_wait,
+    .cheap_try_wait = 1,
+    .destroy = named_destroy,
+};
@@ -0,0 +1,108 @@
+#include <stdio.h>
+#include <errno.h>
+#include <semaphore.h>
+
+#include "smokers.h"
+
+// unnamed POSIX semaphores placed in the shared memory area, stride bytes apart
+struct unnamed_area {
+    size_t stride; // distance between semaphores
+    _Alignas(CACHE_LINE) unsigned char sems[];
+};
+
+static struct unnamed_area *shared; // area in shared memory
+static int count; // number of semaphores
+
+// function to get a semaphore in the area
+static sem_t *unnamed_sem(int sem) {
+    return (sem_t *) (shared->sems + sem * shared->stride);
+}
+
+// function to get the size of the area for nsems semaphores
+static size_t unnamed_area_size(int nsems) {
+    return sizeof(struct unnamed_area) + nsems * sem_stride(sizeof(sem_t));
+}
+
+// function to initialize semaphores in the area, process-shared unless the group runs as threads
+static int unnamed_create(void *area, int nsems) {
+    shared = area;
+    shared->stride = sem_stride(sizeof(sem_t));
+    count = nsems;
+    for (int i = 0; i < nsems; i++) { // loop through semaphores
+        if (sem_init(unnamed_sem(i), !threads, 0) == -1) { // check for errors
+            perror("sem_init");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// function to attach to semaphores which already live in the area
+static int unnamed_attach(void *area, int nsems) {
+    shared = area;
+    count = nsems;
+    return 0;
+}
+
+// function to wait for a semaphore
+static int unnamed_wait(int sem) {
+    while (sem_wait(unnamed_sem(sem)) == -1) { // retry if interrupted by a signal
+        if (errno != EINTR) {
+            perror("sem_wait");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// function to take one unit without blocking, sem_trywait stays in user space
+static int unnamed_try_wait(int sem) {
+    if (sem_trywait(unnamed_sem(sem)) == 0) {
+        return 1;
+    }
+    if (errno == EAGAIN || errno == EINTR) { // semaphore is 0
+        return 0;
+    }
+    perror("sem_trywait");
+    return -1;
+}
+
+// function to read the value of a semaphore
+static int unnamed_value(int sem) {
+    int value;
+    if (sem_getvalue(unnamed_sem(sem), &value) == -1) { // check for errors
+        perror("sem_getvalue");
+        return -1;
+    }
+    return value;
+}
+
+// function to signal a semaphore
+static int unnamed_post(int sem) {
+    if (sem_post(unnamed_sem(sem)) == -1) { // check for errors
+        perror("sem_post");
+        return -1;
+    }
+    return 0;
+}
+
+// function to destroy semaphores in the area
+static void unnamed_destroy(void) {
+    for (int i = 0; i < count; i++) { // loop through semaphores
+        sem_destroy(unnamed_sem(i));
+    }
+}
+
+const struct sync_backend posix_unnamed_backend = {
+    .name = "posix-unnamed",
+    .variants = "mod_4",
+    .area_size = unnamed_area_size,
+    .create = unnamed_create,
+    .attach = unnamed_attach,
+    .wait = unnamed_wait,
+    .post = unnamed_post,
+    .try_wait = unnamed_try_wait,
+    .cheap_try_wait = 1,
+    .value = unnamed_value,
+    .destroy = unnamed_destroy,
+};
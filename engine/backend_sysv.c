@@ -0,0 +1,174 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ipc.h>
+#include <sys/sem.h>
+
+#include "smokers.h"
+
+// seconds a wait blocks before checking that the owner of the set is still alive
+#define SYSV_WAIT_TIMEOUT 1
+
+// state shared between processes
+struct sysv_area {
+    int semid; // id of the semaphore set
+    int max_ops; // largest number of operations in one semop call (SEMOPM)
+    pid_t owner; // process which created the set
+    _Atomic unsigned long calls; // semop and semtimedop syscalls made by all processes
+    _Atomic unsigned long ops; // unit increments and decrements applied, one syscall each without batching
+};
+
+static struct sysv_area *shared; // area in shared memory
+
+// function to get the size of the area
+static size_t sysv_area_size(int nsems) {
+    return sizeof(struct sysv_area);
+}
+
+// function to create a set of nsems semaphores
+static int sysv_create(void *area, int nsems) {
+    shared = area;
+    shared->semid = semget(IPC_PRIVATE, nsems, IPC_CREAT | 0666); // create semaphores with read-write permissions
+    if (shared->semid == -1) { // check for errors
+        perror("semget");
+        return -1;
+    }
+    unsigned short *values = calloc(nsems, sizeof(unsigned short)); // initial values are 0
+    if (values == NULL) {
+        perror("calloc");
+        return -1;
+    }
+    int result = semctl(shared->semid, 0, SETALL, values); // initialize all semaphores at once
+    free(values);
+    if (result == -1) { // check for errors
+        perror("semctl");
+        return -1;
+    }
+    struct seminfo info;
+    shared->max_ops = semctl(shared->semid, 0, IPC_INFO, (struct seminfo *) &info) == -1 ? 32 : info.semopm;
+    shared->owner = getpid();
+    atomic_init(&shared->calls, 0);
+    atomic_init(&shared->ops, 0);
+    return 0;
+}
+
+// function to attach to an existing semaphore set
+static int sysv_attach(void *area, int nsems) {
+    shared = area;
+    return 0;
+}
+
+// function to apply count operations atomically in one call, waits are bounded with semtimedop
+static int sysv_ops(struct sembuf *ops, int count) {
+    struct timespec timeout = {SYSV_WAIT_TIMEOUT, 0};
+    unsigned long units = 0;
+    for (int i = 0; i < count; i++) { // a post or wait of value n replaces n single calls
+        units += abs(ops[i].sem_op);
+    }
+    atomic_fetch_add_explicit(&shared->ops, units, memory_order_relaxed);
+    while (1) {
+        atomic_fetch_add_explicit(&shared->calls, 1, memory_order_relaxed);
+        if (semtimedop(shared->semid, ops, count, &timeout) == 0) {
+            return 0;
+        }
+        if (errno == EAGAIN) { // timed out, give up only if the owner exited without removing the set
+            if (kill(shared->owner, 0) == -1 && errno == ESRCH) {
+                fprintf(stderr, "semtimedop: owner %d exited\n", (int) shared->owner);
+                return -1;
+            }
+        } else if (errno != EINTR) { // retry if interrupted by a signal
+            perror("semtimedop");
+            return -1;
+        }
+    }
+}
+
+// function to perform a single semaphore operation
+static int sysv_op(int sem, int value) {
+    struct sembuf op; // semaphore operation struct
+    op.sem_num = sem; // set semaphore number
+    op.sem_op = value; // set operation
+    op.sem_flg = 0; // set flags to 0
+    return sysv_ops(&op, 1);
+}
+
+// function to wait for a semaphore
+static int sysv_wait(int sem) {
+    return sysv_op(sem, -1);
+}
+
+// function to signal a semaphore
+static int sysv_post(int sem) {
+    return sysv_op(sem, 1);
+}
+
+// function to add value to count semaphores with one sembuf array per SEMOPM operations
+static int sysv_post_batch(const int *sems, int count, int value) {
+    struct sembuf *ops = calloc(count, sizeof(struct sembuf));
+    if (ops == NULL) {
+        perror("calloc");
+        return -1;
+    }
+    for (int i = 0; i < count; i++) { // one entry per semaphore
+        ops[i].sem_num = sems[i];
+        ops[i].sem_op = value;
+        ops[i].sem_flg = 0;
+    }
+    int result = 0;
+    for (int i = 0; i < count && result == 0; i += shared->max_ops) { // stay below the kernel limit
+        result = sysv_ops(&ops[i], count - i < shared->max_ops ? count - i : shared->max_ops);
+    }
+    free(ops);
+    return result;
+}
+
+// function to subtract value from a semaphore in one operation
+static int sysv_wait_batch(int sem, int value) {
+    if (value == 0) { // sem_op 0 would wait for the semaphore to become 0
+        return 0;
+    }
+    return sysv_op(sem, -value);
+}
+
+// function to read the value of a semaphore
+static int sysv_value(int sem) {
+    int value = semctl(shared->semid, sem, GETVAL);
+    if (value == -1) { // check for errors
+        perror("semctl");
+    }
+    return value;
+}
+
+// function to print the number of SysV syscalls per round with and without batching
+static void sysv_report(int rounds) {
+    unsigned long calls = atomic_load(&shared->calls);
+    unsigned long ops = atomic_load(&shared->ops);
+    printf("sysv: %lu semtimedop calls for %lu operations, %.2f syscalls per round (%.2f with one call per operation).\n",
+           calls, ops, rounds ? (double) calls / rounds : 0.0, rounds ? (double) ops / rounds : 0.0);
+}
+
+// function to remove the semaphore set
+static void sysv_destroy(void) {
+    if (semctl(shared->semid, 0, IPC_RMID) == -1) { // check for errors
+        perror("semctl");
+    }
+}
+
+const struct sync_backend sysv_backend = {
+    .name = "sysv",
+    .variants = "mod_6, mod_7",
+    .area_size = sysv_area_size,
+    .create = sysv_create,
+    .attach = sysv_attach,
+    .wait = sysv_wait,
+    .post = sysv_post,
+    .post_batch = sysv_post_batch,
+    .wait_batch = sysv_wait_batch,
+    .value = sysv_value,
+    .report = sysv_report,
+    .destroy = sysv_destroy,
+};
@@ -0,0 +1,388 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+
+#include "smokers.h"
+
+// function to allocate results for the given number of runs
+static struct run_result *alloc_results(int runs) {
+    struct run_result *results = calloc(runs, sizeof(struct run_result));
+    if (results == NULL) {
+        perror("calloc");
+        exit(1);
+    }
+    return results;
+}
+
+// function to run the same workload on every backend (or the one given with --backend) and compare latencies
+static void bench_backends(void) {
+    struct run_result *results = alloc_results(nbackends);
+    const struct sync_backend **used = calloc(nbackends, sizeof(*used)); // backends in the order they ran
+    int runs = 0;
+    if (used == NULL) {
+        perror("calloc");
+        exit(1);
+    }
+    const struct sync_backend *selected = backend;
+    for (int i = 0; i < nbackends; i++) { // loop through backends
+        if (backend_set && backends[i] != selected) {
+            continue;
+        }
+        backend = backends[i];
+        run_group(&results[runs]);
+        used[runs++] = backend;
+    }
+    printf("\n");
+    print_latency_header();
+    for (int i = 0; i < runs; i++) { // loop through finished runs
+        print_latency(used[i]->name, results[i].hist);
+    }
+    printf("\n");
+    for (int i = 0; i < runs; i++) { // hardware counters per backend
+        perf_print(used[i]->name, results[i].perf, results[i].rounds);
+    }
+    printf("\n");
+    for (int i = 0; i < runs; i++) { // show which homework variant each backend stands for
+        printf("%s: %s\n", used[i]->name, used[i]->variants);
+    }
+    free(results);
+    free(used);
+}
+
+// function to run the same workload with packed and cache-line-partitioned mailboxes and compare cache misses
+static void bench_layouts(void) {
+    static const char *names[] = {"packed", "mailbox"};
+    struct run_result *results = alloc_results(2);
+    for (int i = 0; i < 2; i++) { // LAYOUT_PACKED, then LAYOUT_MAILBOX
+        layout = i;
+        run_group(&results[i]);
+    }
+    printf("\n");
+    print_latency_header();
+    for (int i = 0; i < 2; i++) { // loop through layouts
+        print_latency(names[i], results[i].hist);
+    }
+    printf("\n");
+    for (int i = 0; i < 2; i++) { // hardware counters per layout
+        perf_print(names[i], results[i].perf, results[i].rounds);
+    }
+    free(results);
+}
+
+// function to run every backend (or the one given with --backend) as processes and as threads
+// and compare round latency and context switches per round
+static void bench_threads(void) {
+    static const char *modes[] = {"process", "thread"};
+    struct run_result *results = alloc_results(2 * nbackends);
+    char (*labels)[64] = calloc(2 * nbackends, sizeof(*labels)); // backend and mode of every run
+    int runs = 0;
+    if (labels == NULL) {
+        perror("calloc");
+        exit(1);
+    }
+    const struct sync_backend *selected = backend;
+    for (int i = 0; i < nbackends; i++) { // loop through backends
+        if (backend_set && backends[i] != selected) {
+            continue;
+        }
+        backend = backends[i];
+        for (threads = 0; threads < 2; threads++) { // fork-based, then thread-based
+            snprintf(labels[runs], sizeof(labels[runs]), "%s/%s", backend->name, modes[threads]);
+            run_group(&results[runs++]);
+        }
+    }
+    threads = 0;
+    printf("\n");
+    print_latency_header();
+    for (int i = 0; i < runs; i++) { // loop through finished runs
+        print_latency(labels[i], results[i].hist);
+    }
+    printf("\n%-22s %14s %18s\n", "run", "rounds/sec", "ctx-switch/round");
+    for (int i = 0; i < runs; i++) {
+        printf("%-22s %14.1f %18.2f\n", labels[i], results[i].rate,
+               results[i].rounds ? (double) results[i].context_switches / results[i].rounds : 0.0);
+    }
+    free(results);
+    free(labels);
+}
+
+// function to run every backend which can spin (or the one given with --backend) blocking at once and
+// spinning adaptively, and compare handoff latency against spin hits and CPU burn
+static void bench_spin(void) {
+    static const char *modes[] = {"block", "spin"};
+    struct run_result *results = alloc_results(2 * nbackends);
+    char (*labels)[64] = calloc(2 * nbackends, sizeof(*labels)); // backend and mode of every run
+    int runs = 0;
+    if (labels == NULL) {
+        perror("calloc");
+        exit(1);
+    }
+    const struct sync_backend *selected = backend;
+    for (int i = 0; i < nbackends; i++) { // loop through backends
+        if ((backend_set && backends[i] != selected) || !backends[i]->cheap_try_wait) {
+            continue;
+        }
+        backend = backends[i];
+        for (int mode = 0; mode < 2; mode++) { // block at once, then spin adaptively
+            spin_limit = mode ? SPIN_ADAPTIVE : 0;
+            snprintf(labels[runs], sizeof(labels[runs]), "%s/%s", backend->name, modes[mode]);
+            run_group(&results[runs++]);
+        }
+    }
+    spin_limit = 0;
+    printf("\n");
+    print_latency_header();
+    for (int i = 0; i < runs; i++) { // loop through finished runs
+        print_latency(labels[i], results[i].hist);
+    }
+    printf("\n%-22s %14s %10s %14s %10s\n", "run", "rounds/sec", "spin hits", "CPU us/round", "CPU load");
+    for (int i = 0; i < runs; i++) {
+        struct run_result *r = &results[i];
+        double elapsed = r->rate > 0 ? r->rounds / r->rate : 0; // seconds of wall time
+        printf("%-22s %14.1f %9.1f%% %14.2f %9.0f%%\n", labels[i], r->rate,
+               r->spin_waits ? 100.0 * r->spin_hits / r->spin_waits : 0.0,
+               r->rounds ? r->cpu_ns / 1e3 / r->rounds : 0.0, elapsed > 0 ? r->cpu_ns / 1e7 / elapsed : 0.0);
+    }
+    free(results);
+    free(labels);
+}
+
+// function to pin the agent to one CPU and every smoker to another, placed on one CPU, hyperthreads of one core,
+// two cores of one socket and two sockets, and compare handoff latency between them
+static void bench_placement(void) {
+    static const char *names[CPU_DISTANCES] = {"same-cpu", "smt-sibling", "same-socket", "cross-socket"};
+    struct run_result *results = alloc_results(CPU_DISTANCES);
+    int pairs[CPU_DISTANCES][2];
+    int ran[CPU_DISTANCES] = {0};
+    static int saved_list[CPU_SETSIZE]; // CPUs given with --cpus
+    int saved_cpus = ncpus, saved_tables = ntables, saved_smokers = nsmokers;
+    memcpy(saved_list, cpu_list, sizeof(saved_list));
+    ntables = 1; // one agent, so its smokers are the only partners
+    if (nsmokers > CPU_SETSIZE - 1) { // the agent and every smoker take one entry of the CPU list
+        printf("placement: %d smokers instead of %d, the CPU list has %d entries.\n", CPU_SETSIZE - 1, nsmokers,
+               CPU_SETSIZE);
+        nsmokers = CPU_SETSIZE - 1;
+    }
+    for (int kind = 0; kind < CPU_DISTANCES; kind++) { // loop through placements
+        if (find_cpu_pair(kind, &pairs[kind][0], &pairs[kind][1]) == -1) {
+            printf("%s: no such pair of CPUs, skipped.\n", names[kind]);
+            continue;
+        }
+        cpu_list[0] = pairs[kind][0]; // agent
+        for (int i = 1; i <= nsmokers; i++) { // smokers
+            cpu_list[i] = pairs[kind][1];
+        }
+        ncpus = nsmokers + 1;
+        printf("%s: agent on CPU %d, smokers on CPU %d.\n", names[kind], pairs[kind][0], pairs[kind][1]);
+        run_group(&results[kind]);
+        ran[kind] = 1;
+    }
+    ncpus = saved_cpus;
+    ntables = saved_tables;
+    nsmokers = saved_smokers;
+    memcpy(cpu_list, saved_list, sizeof(saved_list));
+    printf("\n");
+    print_latency_header();
+    for (int kind = 0; kind < CPU_DISTANCES; kind++) { // loop through placements which ran
+        if (ran[kind]) {
+            print_latency(names[kind], results[kind].hist);
+        }
+    }
+    printf("\n");
+    for (int kind = 0; kind < CPU_DISTANCES; kind++) {
+        if (ran[kind]) {
+            printf("%-22s %14.1f rounds/sec\n", names[kind], results[kind].rate);
+        }
+    }
+    free(results);
+}
+
+// function to measure the time from the start of a group to its first round for 3, 100 and 1000 smokers,
+// with an anonymous segment, one named semaphore object per semaphore and one named versioned segment
+static void bench_startup(void) {
+    static const int sizes[] = {3, 100, 1000};
+    static const char *modes[] = {"anonymous", "named-sems", "object"};
+    const struct sync_backend *mode_backends[] = {&posix_unnamed_backend, &posix_named_backend, &posix_unnamed_backend};
+    const char *mode_names[] = {NULL, NULL, "/smokers-startup"};
+    struct run_result *results = alloc_results(3 * 3);
+    int saved_rounds = max_rounds, saved_smokers = nsmokers, saved_tables = ntables;
+    const struct sync_backend *saved_backend = backend;
+    const char *saved_name = segment_name; // --shm
+    max_rounds = 10; // only the first round is measured
+    ntables = 1;
+    for (int s = 0; s < 3; s++) { // loop through group sizes
+        nsmokers = sizes[s];
+        for (int m = 0; m < 3; m++) { // loop through ways to create the shared state
+            backend = mode_backends[m];
+            segment_name = mode_names[m];
+            run_group(&results[s * 3 + m]);
+        }
+    }
+    max_rounds = saved_rounds;
+    nsmokers = saved_smokers;
+    ntables = saved_tables;
+    backend = saved_backend;
+    segment_name = saved_name;
+    printf("\n%8s", "smokers");
+    for (int m = 0; m < 3; m++) {
+        printf(" %14s", modes[m]);
+    }
+    printf("   (time to first round, ms)\n");
+    for (int s = 0; s < 3; s++) {
+        printf("%8d", sizes[s]);
+        for (int m = 0; m < 3; m++) {
+            printf(" %14.3f", results[s * 3 + m].startup_ns / 1e6);
+        }
+        printf("\n");
+    }
+    free(results);
+}
+
+// function to run every scheduling policy on the same group and compare throughput, fairness and waits
+static void bench_policies(void) {
+    struct run_result *results = alloc_results(npolicies);
+    const struct agent_policy *selected = policy;
+    for (int i = 0; i < npolicies; i++) { // loop through policies
+        policy = policies[i];
+        run_group(&results[i]);
+    }
+    policy = selected;
+    printf("\n%-12s %14s %8s %14s %14s\n", "policy", "rounds/sec", "jain", "p99 wait us", "missed");
+    for (int i = 0; i < npolicies; i++) {
+        printf("%-12s %14.1f %8.4f %14.1f %14lu\n", policies[i]->name, results[i].rate, results[i].fairness,
+               results[i].wait_p99_max / 1e3, (unsigned long) results[i].deadline_misses);
+    }
+    free(results);
+}
+
+// function to select a service time model of a benchmark suite
+static void use_service_model(const char *spec) {
+    if (parse_service_model(spec) == -1) { // check for errors
+        fprintf(stderr, "Invalid service time model: %s\n", spec);
+        exit(1);
+    }
+}
+
+// function to compare pushing with depth 1, pushing with one round in flight per smoker and pulling,
+// service times are uneven (log-normal, median 50 us) unless --smoke was given
+static void bench_pull(void) {
+    static const char *modes[] = {"push depth 1", "push depth N", "pull"};
+    struct run_result *results = alloc_results(3);
+    struct service_settings saved_service;
+    save_service_model(&saved_service);
+    if (!smoke_set) {
+        use_service_model("lognormal:50000:1");
+    }
+    int saved_depth = depth;
+    for (int m = 0; m < 3; m++) { // loop through modes
+        depth = m == 1 ? (nsmokers < MAX_DEPTH ? nsmokers : MAX_DEPTH) : 1;
+        pull = m == 2;
+        run_group(&results[m]);
+    }
+    depth = saved_depth;
+    pull = 0;
+    restore_service_model(&saved_service);
+    printf("\n");
+    print_latency_header();
+    for (int m = 0; m < 3; m++) { // wake is the time a round queued behind a busy smoker
+        print_latency(modes[m], results[m].hist);
+    }
+    printf("\n%-22s %14s %8s %14s\n", "mode", "rounds/sec", "jain", "p99 wait us");
+    for (int m = 0; m < 3; m++) {
+        printf("%-22s %14.1f %8.4f %14.1f\n", modes[m], results[m].rate, results[m].fairness,
+               results[m].wait_p99_max / 1e3);
+    }
+    free(results);
+}
+
+// function to compare releasing the table after smoking and at pickup for 3, 6 and 12 smokers
+// and service times of 100 us and 1 ms, 2000 rounds each unless --rounds was given
+static void bench_release(void) {
+    static const int sizes[] = {3, 6, 12};
+    static const char *services[] = {"const:100000", "const:1000000"};
+    struct run_result *results = alloc_results(3 * 2 * 2);
+    int used[3]; // smokers of every size, at least one per item
+    int saved_rounds = max_rounds, saved_smokers = nsmokers;
+    struct service_settings saved_service;
+    save_service_model(&saved_service);
+    if (!rounds_set) { // a million smoking times would take too long
+        max_rounds = 2000;
+    }
+    for (int s = 0; s < 3; s++) { // loop through group sizes
+        nsmokers = used[s] = sizes[s] > nitems ? sizes[s] : nitems;
+        for (int t = 0; t < 2; t++) { // loop through service times
+            use_service_model(services[t]);
+            for (int r = 0; r < 2; r++) { // after smoking, then at pickup
+                release_at_pickup = r;
+                run_group(&results[(s * 2 + t) * 2 + r]);
+            }
+        }
+    }
+    release_at_pickup = 0;
+    max_rounds = saved_rounds;
+    nsmokers = saved_smokers;
+    restore_service_model(&saved_service);
+    printf("\n%8s %10s %14s %14s %8s\n", "smokers", "service", "done r/s", "pickup r/s", "gain");
+    for (int s = 0; s < 3; s++) {
+        for (int t = 0; t < 2; t++) {
+            struct run_result *done = &results[(s * 2 + t) * 2], *pickup = done + 1;
+            printf("%8d %10s %14.1f %14.1f %7.2fx\n", used[s], t ? "1 ms" : "100 us", done->rate, pickup->rate,
+                   done->rate > 0 ? pickup->rate / done->rate : 0.0);
+        }
+    }
+    free(results);
+}
+
+// table of all benchmark suites
+static const struct bench_suite suites[] = {
+    {"backends", bench_backends},
+    {"layouts", bench_layouts},
+    {"threads", bench_threads},
+    {"spin", bench_spin},
+    {"placement", bench_placement},
+    {"startup", bench_startup},
+    {"policies", bench_policies},
+    {"pull", bench_pull},
+    {"release", bench_release},
+    {"ipc", bench_ipc},
+};
+
+#define NSUITES (int) (sizeof(suites) / sizeof(suites[0])) // number of suites
+
+// function to find a benchmark suite by name, returns NULL if there is none
+const struct bench_suite *find_bench(const char *name) {
+    for (int i = 0; i < NSUITES; i++) { // loop through suites
+        if (strcmp(suites[i].name, name) == 0) {
+            return &suites[i];
+        }
+    }
+    return NULL;
+}
+
+// function to print the names of all benchmark suites separated by '|'
+void print_bench_names(void) {
+    for (int i = 0; i < NSUITES; i++) { // loop through suites
+        printf("%s%s", i ? "|" : "", suites[i].name);
+    }
+}
+
+// function to run the same workload for depth 1, 2, 4, ..., max and print rounds/sec against depth
+void run_depth_sweep(int max) {
+    struct run_result *results = alloc_results(MAX_DEPTH + 1);
+    int depths[MAX_DEPTH + 1];
+    int runs = 0;
+    for (depth = 1; ; depth = depth * 2 < max ? depth * 2 : max) {
+        depths[runs] = depth;
+        run_group(&results[runs++]);
+        if (depth == max) {
+            break;
+        }
+    }
+    printf("\n%8s %14s\n", "depth", "rounds/sec");
+    for (int i = 0; i < runs; i++) {
+        printf("%8d %14.1f\n", depths[i], results[i].rate);
+    }
+    free(results);
+}
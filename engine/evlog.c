@@ -0,0 +1,125 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sched.h>
+
+#include "smokers.h"
+
+// verbosity selected with --verbose, events above it are never written
+int verbosity = LOG_ALL;
+
+// event ring in shared memory, NULL when verbosity is LOG_NONE
+struct event_log *event_log;
+
+// function to get the size of an event ring with the given capacity
+size_t event_log_size(int capacity) {
+    return sizeof(struct event_log) + (size_t) capacity * sizeof(struct event);
+}
+
+// function to initialize an event ring, capacity must be a power of two
+void event_log_init(struct event_log *log, int capacity) {
+    log->capacity = capacity;
+    atomic_init(&log->head, 0);
+    atomic_init(&log->tail, 0);
+    atomic_init(&log->closed, 0);
+    for (int i = 0; i < capacity; i++) { // no record is published yet
+        atomic_init(&log->events[i].seq, 0);
+    }
+}
+
+// function to append an event: reserve a position with one atomic add, fill the record, then publish it
+void log_write(int type, int table, int actor, int item, uint64_t arg) {
+    struct event_log *log = event_log;
+    uint64_t pos = atomic_fetch_add_explicit(&log->head, 1, memory_order_relaxed);
+    while (pos - atomic_load_explicit(&log->tail, memory_order_acquire) >= (uint64_t) log->capacity) {
+        sched_yield(); // ring is full, wait for the writer to catch up
+    }
+    struct event *event = &log->events[pos & (log->capacity - 1)];
+    event->ns = now_ns();
+    event->arg = arg;
+    event->actor = actor;
+    event->type = type;
+    event->item = item;
+    event->table = table;
+    atomic_store_explicit(&event->seq, pos + 1, memory_order_release); // readers wait for seq == pos + 1
+}
+
+// function to render one event as the text the homework variants print
+void log_print(FILE *out, const struct event *event) {
+    switch (event->type) {
+        case EV_PUT:
+            fprintf(out, "Agent puts ");
+            fprint_items(out, event->arg);
+            fprintf(out, " on the table.\n");
+            break;
+        case EV_TAKE:
+            fprintf(out, "Smoker %u has ", event->actor);
+            fprint_item_name(out, event->item);
+            fprintf(out, ".\nSmoker %u takes ", event->actor);
+            fprint_items(out, event->arg);
+            fprintf(out, " from the table.\nSmoker %u rolls and smokes a cigarette.\n", event->actor);
+            break;
+        case EV_DONE:
+            fprintf(out, "Maximum rounds reached on table %u. Terminating program.\n", event->table);
+            break;
+        default:
+            fprintf(out, "Unknown event %u.\n", event->type);
+            break;
+    }
+}
+
+// function to copy published events out of the ring, returns the number of events copied
+static int log_drain(struct event_log *log, struct event *out, int max) {
+    uint64_t tail = atomic_load_explicit(&log->tail, memory_order_relaxed);
+    int count = 0;
+    while (count < max) {
+        struct event *event = &log->events[tail & (log->capacity - 1)];
+        if (atomic_load_explicit(&event->seq, memory_order_acquire) != tail + 1) { // not published yet
+            break;
+        }
+        out[count++] = *event;
+        tail++;
+    }
+    atomic_store_explicit(&log->tail, tail, memory_order_release); // free the records for producers
+    return count;
+}
+
+// function to run the background writer: render events as text, or store raw records if binary is set
+void log_writer(FILE *out, int binary) {
+    struct event batch[256]; // events copied out of the ring
+    struct timespec idle = {0, 1000000}; // 1 ms between polls of an empty ring
+    while (1) {
+        int closed = atomic_load(&event_log->closed); // read before draining so no event is missed
+        int count = log_drain(event_log, batch, 256);
+        if (binary) {
+            fwrite(batch, sizeof(struct event), count, out);
+        } else {
+            for (int i = 0; i < count; i++) { // loop through copied events
+                log_print(out, &batch[i]);
+            }
+        }
+        if (count == 0) {
+            if (closed) { // every producer has exited and the ring is empty
+                break;
+            }
+            fflush(out);
+            nanosleep(&idle, NULL);
+        }
+    }
+    fflush(out);
+}
+
+// function to render a file of raw records written with --log-file
+int log_decode(const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) { // check for errors
+        perror(path);
+        return -1;
+    }
+    struct event event;
+    while (fread(&event, sizeof(event), 1, file) == 1) { // loop through records
+        log_print(stdout, &event);
+    }
+    fclose(file);
+    return 0;
+}
@@ -0,0 +1,266 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <sched.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#include "smokers.h"
+
+// primitive measured by the IPC benchmark: a synchronization backend, or a pipe or socket pair per semaphore
+// where a post writes one byte and a wait reads one
+struct ipc_primitive {
+    const char *name; // name in the report
+    const struct sync_backend *backend; // NULL for descriptor pairs
+    int (*make_pair)(int fds[2]); // creates the read end fds[0] and write end fds[1]
+};
+
+// state shared by the processes of one run, the backend area follows it
+struct ipc_shared {
+    _Atomic int ready; // processes waiting for the start
+    _Atomic int go; // set by the parent once every process is ready
+    struct latency_hist hist; // round trip of a ping-pong or of a fan-out to every consumer and back
+};
+
+// traffic patterns of the benchmark
+enum ipc_pattern {
+    IPC_PING_PONG, // one process posts its partner and waits for the reply
+    IPC_FAN_OUT, // one producer posts every consumer and waits for all of them
+    IPC_PATTERNS
+};
+
+static const struct ipc_primitive *current; // primitive of the run
+static int *fds; // read and write end of every semaphore of a descriptor pair primitive
+
+// function to create a pipe
+static int make_pipe(int pair[2]) {
+    return pipe(pair);
+}
+
+// function to create a connected pair of UNIX stream sockets
+static int make_socket_pair(int pair[2]) {
+    return socketpair(AF_UNIX, SOCK_STREAM, 0, pair);
+}
+
+// function to create nsems semaphores of the current primitive, the backend area starts at area
+static int ipc_create(void *area, int nsems) {
+    if (current->backend != NULL) {
+        return current->backend->create(area, nsems);
+    }
+    fds = calloc(2 * nsems, sizeof(int));
+    if (fds == NULL) {
+        perror("calloc");
+        return -1;
+    }
+    for (int i = 0; i < nsems; i++) { // one descriptor pair per semaphore
+        if (current->make_pair(&fds[2 * i]) == -1) {
+            perror(current->name);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// function to wait for a semaphore of the current primitive
+static int ipc_wait(int sem) {
+    if (current->backend != NULL) {
+        return current->backend->wait(sem);
+    }
+    char byte;
+    while (read(fds[2 * sem], &byte, 1) != 1) { // retry if interrupted by a signal
+        if (errno != EINTR) {
+            perror("read");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// function to signal a semaphore of the current primitive
+static int ipc_post(int sem) {
+    if (current->backend != NULL) {
+        return current->backend->post(sem);
+    }
+    char byte = 0;
+    while (write(fds[2 * sem + 1], &byte, 1) != 1) { // retry if interrupted by a signal
+        if (errno != EINTR) {
+            perror("write");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// function to remove the semaphores of the current primitive
+static void ipc_destroy(int nsems) {
+    if (current->backend != NULL) {
+        current->backend->destroy();
+        return;
+    }
+    for (int i = 0; i < 2 * nsems; i++) {
+        close(fds[i]);
+    }
+    free(fds);
+    fds = NULL;
+}
+
+// function to run one process of a group: the leader (index 0) times every round trip, the others answer it
+// consumer k waits on semaphore base + k - 1 and answers on base + consumers, a ping-pong has one consumer
+static void ipc_process(struct ipc_shared *shared, int base, int consumers, int index, int rounds) {
+    int reply = base + consumers;
+    atomic_fetch_add(&shared->ready, 1);
+    while (!atomic_load(&shared->go)) { // start every group at once
+        sched_yield();
+    }
+    for (int r = 0; r < rounds; r++) { // loop through round trips
+        if (index > 0) { // partner or consumer
+            if (ipc_wait(base + index - 1) == -1 || ipc_post(reply) == -1) {
+                _exit(1);
+            }
+            continue;
+        }
+        uint64_t start = now_ns();
+        for (int k = 0; k < consumers; k++) { // the partner, or every consumer
+            if (ipc_post(base + k) == -1) {
+                _exit(1);
+            }
+        }
+        for (int k = 0; k < consumers; k++) {
+            if (ipc_wait(reply) == -1) {
+                _exit(1);
+            }
+        }
+        hist_record(&shared->hist, now_ns() - start);
+    }
+    _exit(0);
+}
+
+// function to run groups independent copies of a pattern on the current primitive and print one JSON result
+// every process is pinned to its own CPU of --cpus or of the online CPUs, in order, wrapping around if there are few
+static void ipc_run(enum ipc_pattern pattern, int groups, int consumers, int rounds, int online, int *first) {
+    static const char *names[IPC_PATTERNS] = {"ping-pong", "fan-out"};
+    int members = consumers + 1; // processes of a group, one semaphore each
+    int nsems = groups * members;
+    size_t head = (sizeof(struct ipc_shared) + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+    size_t size = head + (current->backend != NULL ? current->backend->area_size(nsems) : 0);
+    size_t mapped;
+    struct ipc_shared *shared = map_segment(size, 0, &mapped); // zero-filled and shared with children
+    if (shared == NULL) {
+        exit(1);
+    }
+    if (ipc_create((char *) shared + head, nsems) == -1) {
+        exit(1);
+    }
+    long switches_before, switches_after;
+    uint64_t cpu_before, cpu_after;
+    group_usage(&switches_before, &cpu_before);
+    int count = groups * members;
+    pid_t *pids = calloc((unsigned int) count, sizeof(pid_t));
+    if (pids == NULL) {
+        perror("calloc");
+        exit(1);
+    }
+    fflush(stdout); // do not duplicate buffered output in children
+    for (int i = 0; i < count; i++) { // loop through processes of every group
+        pids[i] = fork();
+        if (pids[i] == -1) { // check for errors
+            perror("fork");
+            exit(1);
+        }
+        if (pids[i] == 0) { // child process
+            pin_to_cpu(ncpus > 0 ? cpu_list[i % ncpus] : i % online);
+            if (current->backend != NULL && current->backend->attach((char *) shared + head, nsems) == -1) {
+                _exit(1);
+            }
+            ipc_process(shared, i / members * members, consumers, i % members, rounds);
+        }
+    }
+    int failed = 0;
+    uint64_t deadline = now_ns() + 10000000000ULL; // 10 s for every process to attach
+    while (!failed && atomic_load(&shared->ready) < count) { // let every process reach the start
+        int status;
+        if (waitpid(-1, &status, WNOHANG) > 0 || now_ns() > deadline) { // one could not attach or died
+            failed = 1;
+            fprintf(stderr, "%s: a process of the run ended or hung before the start\n", current->name);
+            for (int i = 0; i < count; i++) { // the others would wait for the start forever
+                kill(pids[i], SIGKILL);
+            }
+        }
+        sched_yield();
+    }
+    uint64_t start = now_ns();
+    atomic_store(&shared->go, 1);
+    for (int i = 0; i < count; i++) { // wait for child processes to terminate
+        int status;
+        if (waitpid(pids[i], &status, 0) == -1 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            failed = 1;
+        }
+    }
+    double elapsed = (now_ns() - start) / 1e9;
+    group_usage(&switches_after, &cpu_after);
+    uint64_t ops = (uint64_t) groups * rounds;
+    struct latency_hist *hist = &shared->hist;
+    printf("%s\n    {\"primitive\": \"%s\", \"pattern\": \"%s\", \"groups\": %d, \"processes\": %d, \"rounds\": %d,",
+           *first ? "" : ",", current->name, names[pattern], groups, count, rounds);
+    printf(" \"ok\": %s, \"ops_per_sec\": %.1f,\n", failed ? "false" : "true",
+           !failed && elapsed > 0 ? ops / elapsed : 0.0);
+    printf("     \"latency_ns\": {\"p50\": %lu, \"p90\": %lu, \"p99\": %lu, \"p999\": %lu, \"max\": %lu},\n",
+           (unsigned long) hist_percentile(hist, 0.5), (unsigned long) hist_percentile(hist, 0.9),
+           (unsigned long) hist_percentile(hist, 0.99), (unsigned long) hist_percentile(hist, 0.999),
+           (unsigned long) atomic_load(&hist->max));
+    printf("     \"context_switches\": %ld, \"cpu_ns\": %lu, \"cpu_ns_per_op\": %.1f}",
+           switches_after - switches_before, (unsigned long) (cpu_after - cpu_before),
+           ops ? (double) (cpu_after - cpu_before) / ops : 0.0);
+    fflush(stdout);
+    *first = 0;
+    free(pids);
+    ipc_destroy(nsems);
+    if (munmap(shared, mapped) == -1) { // check for errors
+        perror("munmap");
+    }
+}
+
+// function to compare the primitives behind the homework variants without the rest of the engine:
+// ping-pong between two processes and a fan-out from one producer to --smokers consumers,
+// for 1, 2, 4, ... groups while every process of them can have its own CPU, printed as one JSON document
+// --backend keeps only that backend, pipes and UNIX sockets run every time
+void bench_ipc(void) {
+    static const struct ipc_primitive descriptor_pairs[] = {
+        {"pipe", NULL, make_pipe},
+        {"unix-socket", NULL, make_socket_pair},
+    };
+    int online = ncpus > 0 ? ncpus : (int) sysconf(_SC_NPROCESSORS_ONLN);
+    int rounds = rounds_set ? max_rounds : 20000; // every round is a syscall pair, fewer are enough
+    int nprimitives = nbackends + 2;
+    struct ipc_primitive *primitives = calloc(nprimitives, sizeof(struct ipc_primitive));
+    if (primitives == NULL) {
+        perror("calloc");
+        exit(1);
+    }
+    int count = 0;
+    for (int i = 0; i < nbackends; i++) { // every backend, or the one given with --backend
+        if (!backend_set || backends[i] == backend) {
+            primitives[count].name = backends[i]->name;
+            primitives[count++].backend = backends[i];
+        }
+    }
+    primitives[count++] = descriptor_pairs[0];
+    primitives[count++] = descriptor_pairs[1];
+    int first = 1; // no comma before the first result
+    printf("{\"benchmark\": \"ipc\", \"cpus\": %d, \"consumers\": %d, \"results\": [", online, nsmokers);
+    for (int p = 0; p < count; p++) { // loop through primitives
+        current = &primitives[p];
+        for (int pattern = 0; pattern < IPC_PATTERNS; pattern++) {
+            int consumers = pattern == IPC_PING_PONG ? 1 : nsmokers;
+            for (int groups = 1; groups == 1 || groups * (consumers + 1) <= online; groups *= 2) { // 1, 2, 4, ...
+                ipc_run(pattern, groups, consumers, rounds, online, &first);
+            }
+        }
+    }
+    printf("\n]}\n");
+    free(primitives);
+}
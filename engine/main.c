@@ -0,0 +1,1041 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <signal.h>
+#include <sched.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <sys/ipc.h>
+#include <libgen.h>
+
+#include "smokers.h"
+
+// backend selected with --backend
+const struct sync_backend *backend = &posix_unnamed_backend;
+
+// maximum number of rounds selected with --rounds
+int max_rounds = MAX_ROUNDS;
+
+// number of smokers and items selected with --smokers and --items
+int nsmokers = SMOKERS;
+int nitems = ITEMS;
+
+// number of table slots selected with --depth
+int depth = 1;
+
+// placement of the per-smoker state selected with --layout
+int layout = LAYOUT_MAILBOX;
+
+// set by --threads: agent and smokers are threads of one process instead of forked processes
+int threads = 0;
+
+// number of smoker workers selected with --workers, 0 runs one process or thread per smoker
+int workers = 0;
+
+// scheduling policy selected with --policy
+const struct agent_policy *policy;
+
+// weights selected with --weights, smoker i gets weights[i % nweights], 1 if none were given
+int weights[MAX_WEIGHTS];
+int nweights = 0;
+
+// set by --release=pickup: smokers hand the table back when they take the items instead of after smoking
+int release_at_pickup = 0;
+
+// set by --pull: smokers advertise when they are idle and the agent gives rounds only to idle smokers
+int pull = 0;
+
+// seed of every generator selected with --seed, fixed in benchmarks unless given
+uint64_t seed = 1;
+int seed_set = 0;
+
+// relative deadline selected with --deadline, a smoker of weight w must be served within deadline_ns / w
+uint64_t deadline_ns = 1000000;
+int deadline_set = 0;
+
+// benchmark mode selected with --bench: no printing and no smoking time
+int bench = 0;
+const char *bench_name = "backends"; // benchmark suite selected with --bench=NAME
+
+// set when --backend, --layout, --rounds or --smoke were given explicitly
+int backend_set = 0;
+int layout_set = 0;
+int rounds_set = 0;
+int smoke_set = 0;
+
+// file for raw event records selected with --log-file, NULL renders text to stdout
+const char *log_path = NULL;
+
+// file for the trace of every round selected with --trace, NULL disables tracing
+const char *trace_path = NULL;
+
+// set by SIGUSR1: the supervisor writes a snapshot of the trace
+volatile sig_atomic_t trace_requested = 0;
+
+// largest depth of the sweep selected with --depth-sweep, 0 runs a single group
+int sweep_depth = 0;
+
+// number of independent tables selected with --tables
+int ntables = 1;
+
+// role selected with --role or the name of the program: the whole group, only the agent, one smoker or a monitor
+enum role {ROLE_GROUP, ROLE_AGENT, ROLE_SMOKER, ROLE_MONITOR};
+enum role role = ROLE_GROUP;
+int ingredient = -1; // item of a smoker selected with --ingredient
+char key_name[32]; // segment name derived from --key
+
+// global pointer to shared memory, the first table starts the segment
+struct shared_mem *mem;
+size_t mem_size; // size of shared memory
+size_t mapped_size; // size of the mapping, rounded up to whole pages
+size_t table_size; // size of the shared memory of one table
+
+// pid of the process which owns the semaphores and shared memory
+pid_t owner_pid;
+
+// set while agent and smoker threads may still use the memory
+int threads_running = 0;
+
+// table and index of an agent or smoker thread, index nsmokers is the agent
+struct participant {
+    pthread_t thread; // thread running the participant
+    int table; // table the participant belongs to, -1 for a smoker worker
+    int index; // smoker index, nsmokers for the agent, worker id for a smoker worker
+};
+
+// function to handle keyboard interrupt signal (Ctrl+C)
+void sigint_handler(int sig) {
+    printf("\nKeyboard interrupt received. Terminating program.\n");
+    exit(0); // exit program
+}
+
+// function to handle SIGUSR1 by requesting a snapshot of the trace
+void sigusr1_handler(int sig) {
+    trace_requested = 1;
+}
+
+// function to clean up resources before exiting program
+void cleanup() {
+    if (getpid() != owner_pid || mem == NULL) { // children inherit atexit handlers, only the owner removes resources
+        return;
+    }
+
+    // let the log writer finish once the ring is empty
+    if (event_log != NULL) {
+        atomic_store(&event_log->closed, 1);
+    }
+
+    // remove semaphores
+    backend->destroy();
+
+    // remove the name of a published segment, processes which mapped it keep their mapping
+    if (segment_name != NULL) {
+        unlink_segment();
+    }
+
+    if (threads && threads_running) { // threads still use the memory until the process exits
+        return;
+    }
+
+    // deallocate shared memory using munmap
+    if (munmap(mem, mapped_size) == -1) { // check for errors
+        perror("munmap");
+    }
+    mem = NULL;
+}
+
+// function to print usage information
+void usage(const char *prog) {
+    printf("Usage: %s [--backend=", prog);
+    print_backend_names();
+    printf("] [--rounds=N] [--smokers=M] [--items=K] [--tables=N] [--depth=N] [--depth-sweep=MAX]\n");
+    printf("       [--threads] [--workers=N] [--spin=off|adaptive|N] [--cpus=LIST] [--numa-node=N]\n");
+    printf("       [--hugepages] [--prefault] [--shm=/NAME]");
+    printf(" [--layout=packed|mailbox] [--bench[=");
+    print_bench_names();
+    printf("]]\n");
+    printf("       [--verbose=0|1|2] [--log-file=FILE] [--decode=FILE] [--trace=FILE]\n");
+    printf("       [--role=agent|smoker|monitor] [--ingredient=tobacco|paper|match|N] [--key=PATH]\n");
+    printf("       [--interval=MS] [--prometheus=FILE]\n");
+    printf("       [--policy=");
+    print_policy_names();
+    printf("] [--weights=W0,W1,...] [--deadline=NS] [--seed=N] [--pull] [--release=done|pickup]\n");
+    printf("       [--smoke=zero|const:NS|spin:NS|exp:MEAN_NS|lognormal:MEDIAN_NS[:SIGMA]|trace:FILE]\n");
+}
+
+// function to name the segment after the System V key of a path, the same in every process
+void set_segment_key(const char *path) {
+    key_t key = ftok(path, 's'); // same path and project id give the same key in every process
+    if (key == -1) { // check for errors
+        perror(path);
+        exit(1);
+    }
+    snprintf(key_name, sizeof(key_name), "/smokers.%08x", (unsigned int) key);
+    segment_name = key_name;
+}
+
+// function to parse a number in [min, max] or exit with an error
+int parse_int(const char *name, const char *value, int min, int max) {
+    char *end;
+    long result = strtol(value, &end, 10);
+    if (*value == '\0' || *end != '\0' || result < min || result > max) { // check for errors
+        fprintf(stderr, "Invalid value for --%s: %s (expected %d..%d)\n", name, value, min, max);
+        exit(1);
+    }
+    return (int) result;
+}
+
+// function to parse command line options
+void parse_options(int argc, char *argv[]) {
+    static const struct option options[] = {
+        {"backend", required_argument, NULL, 'b'},
+        {"rounds", required_argument, NULL, 'r'},
+        {"smokers", required_argument, NULL, 'm'},
+        {"items", required_argument, NULL, 'k'},
+        {"tables", required_argument, NULL, 't'},
+        {"depth", required_argument, NULL, 'd'},
+        {"depth-sweep", required_argument, NULL, 'D'},
+        {"layout", required_argument, NULL, 'l'},
+        {"verbose", required_argument, NULL, 'v'},
+        {"log-file", required_argument, NULL, 'L'},
+        {"decode", required_argument, NULL, 'X'},
+        {"bench", optional_argument, NULL, 'B'},
+        {"smoke", required_argument, NULL, 's'},
+        {"threads", no_argument, NULL, 'T'},
+        {"workers", required_argument, NULL, 'w'},
+        {"spin", required_argument, NULL, 'S'},
+        {"cpus", required_argument, NULL, 'c'},
+        {"hugepages", no_argument, NULL, 'H'},
+        {"prefault", no_argument, NULL, 'P'},
+        {"shm", required_argument, NULL, 'O'},
+        {"numa-node", required_argument, NULL, 'n'},
+        {"role", required_argument, NULL, 'R'},
+        {"ingredient", required_argument, NULL, 'I'},
+        {"key", required_argument, NULL, 'K'},
+        {"policy", required_argument, NULL, 'p'},
+        {"weights", required_argument, NULL, 'W'},
+        {"deadline", required_argument, NULL, 'e'},
+        {"seed", required_argument, NULL, 'x'},
+        {"pull", no_argument, NULL, 'u'},
+        {"release", required_argument, NULL, 'a'},
+        {"trace", required_argument, NULL, 'A'},
+        {"interval", required_argument, NULL, 'i'},
+        {"prometheus", required_argument, NULL, 'M'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+    const char *name = basename(argv[0]); // agent and smoker may be links to the program
+    if (strcmp(name, "agent") == 0) {
+        role = ROLE_AGENT;
+    } else if (strcmp(name, "smoker") == 0) {
+        role = ROLE_SMOKER;
+    } else if (strcmp(name, "monitor") == 0) {
+        role = ROLE_MONITOR;
+    }
+    policy = find_policy("random");
+    int opt;
+    while ((opt = getopt_long(argc, argv, "b:r:m:k:t:d:h", options, NULL)) != -1) {
+        switch (opt) {
+            case 'b':
+                backend = find_backend(optarg); // look up backend by name
+                if (backend == NULL) {
+                    fprintf(stderr, "Unknown backend: %s\n", optarg);
+                    usage(argv[0]);
+                    exit(1);
+                }
+                backend_set = 1;
+                break;
+            case 'r':
+                max_rounds = parse_int("rounds", optarg, 0, 1 << 30);
+                rounds_set = 1;
+                break;
+            case 'm':
+                nsmokers = parse_int("smokers", optarg, 1, MAX_SMOKERS);
+                break;
+            case 'k':
+                nitems = parse_int("items", optarg, 2, MAX_ITEMS);
+                break;
+            case 't':
+                ntables = parse_int("tables", optarg, 1, MAX_TABLES);
+                break;
+            case 'd':
+                depth = parse_int("depth", optarg, 1, MAX_DEPTH);
+                break;
+            case 'D':
+                sweep_depth = parse_int("depth-sweep", optarg, 1, MAX_DEPTH);
+                break;
+            case 'v':
+                verbosity = parse_int("verbose", optarg, LOG_NONE, LOG_ALL);
+                break;
+            case 'L':
+                log_path = optarg;
+                break;
+            case 'X':
+                exit(log_decode(optarg) == -1 ? 1 : 0); // render a stored log and exit
+            case 'l':
+                if (strcmp(optarg, "packed") == 0) {
+                    layout = LAYOUT_PACKED;
+                } else if (strcmp(optarg, "mailbox") == 0) {
+                    layout = LAYOUT_MAILBOX;
+                } else {
+                    fprintf(stderr, "Unknown layout: %s\n", optarg);
+                    usage(argv[0]);
+                    exit(1);
+                }
+                layout_set = 1;
+                break;
+            case 'B':
+                bench = 1;
+                if (optarg != NULL) {
+                    bench_name = optarg;
+                }
+                if (find_bench(bench_name) == NULL) {
+                    fprintf(stderr, "Unknown benchmark: %s\n", bench_name);
+                    usage(argv[0]);
+                    exit(1);
+                }
+                break;
+            case 's':
+                if (parse_service_model(optarg) == -1) {
+                    fprintf(stderr, "Invalid service time model: %s\n", optarg);
+                    usage(argv[0]);
+                    exit(1);
+                }
+                smoke_set = 1;
+                break;
+            case 'T':
+                threads = 1;
+                break;
+            case 'H':
+                hugepages = 1;
+                break;
+            case 'P':
+                prefault = 1;
+                break;
+            case 'O':
+                if (optarg[0] != '/' || strchr(optarg + 1, '/') != NULL || strlen(optarg) > 40) {
+                    fprintf(stderr, "Invalid shared object name: %s (expected /NAME)\n", optarg);
+                    exit(1);
+                }
+                segment_name = optarg;
+                break;
+            case 'c':
+                ncpus = parse_cpu_list(optarg, cpu_list, CPU_SETSIZE);
+                if (ncpus <= 0) {
+                    fprintf(stderr, "Invalid CPU list: %s\n", optarg);
+                    exit(1);
+                }
+                break;
+            case 'n':
+                numa_node = parse_int("numa-node", optarg, 0, 63);
+                break;
+            case 'S':
+                if (strcmp(optarg, "off") == 0) {
+                    spin_limit = 0;
+                } else if (strcmp(optarg, "adaptive") == 0) {
+                    spin_limit = SPIN_ADAPTIVE;
+                } else {
+                    spin_limit = parse_int("spin", optarg, 0, SPIN_MAX);
+                }
+                break;
+            case 'w':
+                workers = parse_int("workers", optarg, 0, MAX_SMOKERS);
+                break;
+            case 'R':
+                if (strcmp(optarg, "agent") == 0) {
+                    role = ROLE_AGENT;
+                } else if (strcmp(optarg, "smoker") == 0) {
+                    role = ROLE_SMOKER;
+                } else if (strcmp(optarg, "monitor") == 0) {
+                    role = ROLE_MONITOR;
+                } else {
+                    fprintf(stderr, "Unknown role: %s\n", optarg);
+                    usage(argv[0]);
+                    exit(1);
+                }
+                break;
+            case 'I':
+                ingredient = parse_item(optarg);
+                if (ingredient == -1) {
+                    fprintf(stderr, "Invalid ingredient: %s\n", optarg);
+                    exit(1);
+                }
+                break;
+            case 'p':
+                policy = find_policy(optarg);
+                if (policy == NULL) {
+                    fprintf(stderr, "Unknown policy: %s\n", optarg);
+                    usage(argv[0]);
+                    exit(1);
+                }
+                break;
+            case 'W': {
+                char *weight = strtok(optarg, ",");
+                for (nweights = 0; weight != NULL; weight = strtok(NULL, ",")) { // loop through the list
+                    if (nweights == MAX_WEIGHTS) {
+                        fprintf(stderr, "--weights takes at most %d values\n", MAX_WEIGHTS);
+                        exit(1);
+                    }
+                    weights[nweights++] = parse_int("weights", weight, 1, 1000000);
+                }
+                break;
+            }
+            case 'e':
+                deadline_ns = parse_int("deadline", optarg, 1, 1 << 30);
+                deadline_set = 1;
+                break;
+            case 'u':
+                pull = 1;
+                break;
+            case 'a':
+                if (strcmp(optarg, "done") == 0) {
+                    release_at_pickup = 0;
+                } else if (strcmp(optarg, "pickup") == 0) {
+                    release_at_pickup = 1;
+                } else {
+                    fprintf(stderr, "Unknown release point: %s\n", optarg);
+                    usage(argv[0]);
+                    exit(1);
+                }
+                break;
+            case 'A':
+                trace_path = optarg;
+                break;
+            case 'i':
+                monitor_interval_ms = parse_int("interval", optarg, 1, 3600000);
+                break;
+            case 'M':
+                prometheus_path = optarg;
+                break;
+            case 'x': {
+                char *end;
+                seed = strtoull(optarg, &end, 10);
+                if (*optarg == '\0' || *end != '\0') { // check for errors
+                    fprintf(stderr, "Invalid value for --seed: %s\n", optarg);
+                    exit(1);
+                }
+                seed_set = 1;
+                break;
+            }
+            case 'K':
+                set_segment_key(optarg);
+                break;
+            case 'h':
+                usage(argv[0]);
+                exit(0);
+            default:
+                usage(argv[0]);
+                exit(1);
+        }
+    }
+    if (nsmokers < nitems) { // every item needs at least one smoker who has it
+        fprintf(stderr, "--smokers must be at least --items (%d)\n", nitems);
+        exit(1);
+    }
+    if (workers > 0 && !backend_set) { // workers poll semaphores with epoll
+        backend = &eventfd_backend;
+    }
+    if (segment_name != NULL && (backend == &posix_named_backend || backend == &eventfd_backend)) {
+        fprintf(stderr, "--shm needs a backend which keeps its state in the segment\n");
+        exit(1);
+    }
+    if (workers > 0 && backend->wait_fd == NULL) {
+        fprintf(stderr, "--workers needs a backend with pollable semaphores (eventfd)\n");
+        exit(1);
+    }
+    if (pull && release_at_pickup) { // an idle smoker already posts the agent, smoking never holds the table
+        fprintf(stderr, "--pull hands out rounds to idle smokers, --release=pickup does not apply\n");
+        exit(1);
+    }
+    if (role == ROLE_MONITOR && segment_name == NULL) { // watch the group started with --key=. in this directory
+        set_segment_key(".");
+    }
+    if (role != ROLE_GROUP && segment_name == NULL) { // separate processes find each other by name
+        fprintf(stderr, "--role needs --shm=/NAME or --key=PATH\n");
+        exit(1);
+    }
+    if (role == ROLE_AGENT && (threads || workers > 0 || ntables > 1 || bench || sweep_depth > 0)) {
+        fprintf(stderr, "--role=agent runs one table of separately launched smokers\n");
+        exit(1);
+    }
+    if (role == ROLE_SMOKER && ingredient == -1) {
+        fprintf(stderr, "--role=smoker needs --ingredient\n");
+        exit(1);
+    }
+}
+
+// function to get the shared memory of a table
+struct shared_mem *table_at(int index) {
+    return (struct shared_mem *) ((char *) mem + index * table_size);
+}
+
+// function to pin the calling process or thread to one of the CPUs it may run on, spreading tables over cores
+void pin_to_table_cpu(int index) {
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == -1) { // check for errors
+        perror("sched_getaffinity");
+        return;
+    }
+    int target = index % CPU_COUNT(&allowed); // n-th allowed CPU
+    for (int i = 0; i < CPU_SETSIZE; i++) { // loop through CPUs
+        if (CPU_ISSET(i, &allowed) && target-- == 0) {
+            pin_to_cpu(i);
+            return;
+        }
+    }
+}
+
+// function to run the background writer of the event log
+void run_log_writer(void) {
+    if (log_path == NULL) {
+        log_writer(stdout, 0);
+        return;
+    }
+    FILE *file = fopen(log_path, "wb");
+    if (file == NULL) { // check for errors
+        perror(log_path);
+        exit(1);
+    }
+    log_writer(file, 1);
+    fclose(file);
+}
+
+// function to fork the process which renders the event log as text or stores it in --log-file
+pid_t start_log_writer(void) {
+    pid_t pid = fork();
+    if (pid == -1) { // check for errors
+        perror("fork");
+        exit(1);
+    }
+    if (pid != 0) { // parent process
+        return pid;
+    }
+    signal(SIGINT, SIG_IGN); // drain the log even after Ctrl+C, the ring is closed by the parent
+    run_log_writer();
+    exit(0);
+}
+
+// function to run the log writer as a thread of the group
+void *log_writer_thread(void *arg) {
+    run_log_writer();
+    return NULL;
+}
+
+// function to get the position of a participant in --cpus: agent of a table, then its smokers, then workers
+int cpu_slot(int table, int index) {
+    if (table == -1) { // worker
+        return ntables + index;
+    }
+    if (workers > 0) { // only agents run per table
+        return table;
+    }
+    return table * (nsmokers + 1) + (index == nsmokers ? 0 : index + 1);
+}
+
+// function to run an agent, smoker or smoker worker in the calling process or thread
+void run_participant(int table, int index) {
+    if (numa_node >= 0) { // private memory of the participant on the node of the segment
+        use_node_policy();
+    }
+    if (ncpus > 0) { // CPUs given with --cpus
+        pin_to_cpu(cpu_list[cpu_slot(table, index) % ncpus]);
+    } else if (ntables > 1 && table != -1) { // keep every table on its own core
+        pin_to_table_cpu(table);
+    }
+    if (prefault && !threads) { // page tables of a forked child start empty for shared mappings
+        prefault_segment(mem, mapped_size, 0);
+    }
+    uint64_t faults = page_faults();
+    note_setup_done(); // moved on by the participant once its own setup is done
+    if (table == -1) { // worker serving smokers of many tables
+        worker(index);
+    } else if (index == nsmokers) { // agent
+        agent(table_at(table));
+    } else { // smoker
+        smoker(table_at(table), index);
+    }
+    struct shared_mem *counted = table_at(table == -1 ? 0 : table);
+    atomic_fetch_add(&counted->setup_faults, setup_done_faults() - faults);
+    atomic_fetch_add(&counted->faults, page_faults() - setup_done_faults());
+}
+
+// function to run an agent or smoker thread
+void *participant_thread(void *arg) {
+    struct participant *participant = arg;
+    run_participant(participant->table, participant->index);
+    return NULL;
+}
+
+// function to get the number of agents, smokers and smoker workers of the group
+int participant_count(void) {
+    return workers > 0 ? ntables + workers : ntables * (nsmokers + 1);
+}
+
+// function to get the table and index of participant i: agents and smokers of every table, or agents then workers
+void participant_at(int i, int *table, int *index) {
+    if (workers == 0) {
+        *table = i / (nsmokers + 1);
+        *index = i % (nsmokers + 1);
+    } else if (i < ntables) { // agent of table i
+        *table = i;
+        *index = nsmokers;
+    } else { // smoker worker
+        *table = -1;
+        *index = i - ntables;
+    }
+}
+
+// function to run agent and smokers of every table as threads and wait for them to finish
+void run_threads(void) {
+    int count = participant_count();
+    struct participant *participants = calloc(count, sizeof(struct participant));
+    if (participants == NULL) {
+        perror("calloc");
+        exit(1);
+    }
+    threads_running = 1;
+    for (int i = 0; i < count; i++) { // loop through agents and smokers of every table
+        participant_at(i, &participants[i].table, &participants[i].index);
+        int error = pthread_create(&participants[i].thread, NULL, participant_thread, &participants[i]);
+        if (error != 0) { // check for errors
+            fprintf(stderr, "pthread_create: %s\n", strerror(error));
+            exit(1);
+        }
+    }
+    for (int i = 0; i < count; i++) { // wait for threads to terminate
+        pthread_join(participants[i].thread, NULL);
+    }
+    threads_running = 0;
+    free(participants);
+}
+
+// function to fork participant i, see participant_at
+pid_t fork_participant(int i, int nsems) {
+    pid_t pid = fork();
+    if (pid == -1) { // check for errors
+        perror("fork");
+        exit(1);
+    }
+    if (pid == 0) { // child process
+        int table, index;
+        participant_at(i, &table, &index);
+        if (segment_name != NULL) { // attach the published object with one mmap instead of the inherited mapping
+            void *inherited = mem;
+            size_t inherited_size = mapped_size;
+            mem = attach_segment(&mapped_size, 1);
+            if (mem == NULL) {
+                exit(1);
+            }
+            munmap(inherited, inherited_size);
+            size_t log_offset = table_at(0)->log_offset;
+            event_log = log_offset ? (struct event_log *) ((char *) mem + log_offset) : NULL;
+        }
+        if (backend->attach(mem_sync(mem), nsems) == -1) {
+            exit(1);
+        }
+        run_participant(table, index);
+        exit(0); // exit child process
+    }
+    return pid;
+}
+
+// function to respawn a smoker killed by a signal: deliver the rounds it took and did not smoke again,
+// post back the agent tokens of rounds it smoked and did not release,
+// bump the generation and fork a new process which continues at the first of those deliveries,
+// returns -1 if the semaphore of the smoker cannot be repaired
+pid_t respawn_smoker(int i, int nsems, int sig) {
+    int table, index;
+    participant_at(i, &table, &index);
+    struct shared_mem *t = table_at(table);
+    struct mailbox *box = mem_mailbox(t, index);
+    uint64_t start = now_ns();
+    if (backend->recover != NULL && backend->recover(SMOKER_SEM(t, index)) == -1) { // it may have died waiting
+        fprintf(stderr, "Smoker %d of table %d killed by signal %d, its semaphore cannot be repaired.\n",
+                index, table, sig);
+        return -1;
+    }
+    uint64_t taken = atomic_load(&box->taken);
+    uint64_t finished = atomic_load(&box->served) + atomic_load(&box->returned);
+    uint64_t released = atomic_load(&box->released);
+    for (uint64_t r = released; r < finished; r++) { // tokens of smoked rounds it did not post back
+        if (backend->post(AGENT_SEM(t)) == -1) {
+            return -1;
+        }
+    }
+    if (released < finished) {
+        atomic_store(&box->released, finished);
+    }
+    // the deliveries stay in the ring, and their tokens stay held unless they were released at pickup
+    atomic_store(&box->taken, finished);
+    for (uint64_t r = finished; r < taken; r++) { // one post of the smoker semaphore per delivery taken again
+        if (backend->post(SMOKER_SEM(t, index)) == -1) {
+            return -1;
+        }
+    }
+    uint32_t generation = atomic_fetch_add(&box->generation, 1) + 1;
+    atomic_fetch_add(&t->generation, 1);
+    pid_t pid = fork_participant(i, nsems);
+    printf("Smoker %d of table %d (pid %d) killed by signal %d, respawned as pid %d in %.0f us, "
+           "generation %u, %lu round(s) delivered again.\n", index, table, (int) atomic_load(&box->owner), sig, (int) pid,
+           (now_ns() - start) / 1e3, generation, (unsigned long) (taken - finished));
+    fflush(stdout); // do not duplicate buffered output in later children
+    return pid;
+}
+
+// function to fork agent and smokers of every table and supervise them until they finish
+// a smoker killed by a signal is respawned, the group is stopped if an agent or worker is killed
+void run_processes(int nsems) {
+    int count = participant_count();
+    pid_t *pids = calloc(count, sizeof(pid_t)); // running process of every participant
+    if (pids == NULL) {
+        perror("calloc");
+        exit(1);
+    }
+    for (int i = 0; i < count; i++) { // loop through agents and smokers of every table
+        pids[i] = fork_participant(i, nsems);
+    }
+
+    // wait for child processes to terminate
+    int running = count;
+    int stopping = 0; // set once an agent or worker died
+    while (running > 0) {
+        int status;
+        pid_t pid = wait(&status);
+        if (pid == -1) { // retry if interrupted by a signal, SIGUSR1 asks for a snapshot of the trace
+            if (trace_requested && trace_path != NULL) {
+                trace_requested = 0;
+                trace_export(trace_path);
+            }
+            continue;
+        }
+        int i = 0;
+        while (i < count && pids[i] != pid) { // find the participant of the process
+            i++;
+        }
+        if (i == count) { // not a participant
+            continue;
+        }
+        int table, index;
+        participant_at(i, &table, &index);
+        if (!WIFSIGNALED(status) || stopping) { // finished or failed on its own
+            pids[i] = 0;
+            running--;
+            continue;
+        }
+        if (table != -1 && index < nsmokers && !table_at(table)->done) { // smoker died mid-run
+            pids[i] = respawn_smoker(i, nsems, WTERMSIG(status));
+            if (pids[i] != -1) {
+                continue;
+            }
+        } else { // nobody else can take over the agent or a worker
+            fprintf(stderr, "%s of table %d killed by signal %d, stopping the group.\n",
+                    table == -1 ? "Worker" : "Agent", table, WTERMSIG(status));
+        }
+        pids[i] = 0;
+        running--;
+        stopping = 1;
+        for (int j = 0; j < count; j++) {
+            if (pids[j] != 0) {
+                kill(pids[j], SIGKILL);
+            }
+        }
+    }
+    free(pids);
+}
+
+// function to get the context switches and CPU time of the group so far: its threads, or its reaped children
+void group_usage(long *switches, uint64_t *cpu_ns) {
+    struct rusage usage;
+    *switches = 0;
+    *cpu_ns = 0;
+    if (getrusage(threads ? RUSAGE_SELF : RUSAGE_CHILDREN, &usage) == -1) { // check for errors
+        perror("getrusage");
+        return;
+    }
+    *switches = usage.ru_nvcsw + usage.ru_nivcsw;
+    *cpu_ns = (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000000ULL +
+              (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1000ULL;
+}
+
+// function to create the segment, tables and semaphores of a group and publish a named segment
+// slots start free if open_slots is set, so smokers launched with --role=smoker can join, returns the page faults taken
+uint64_t create_group(int open_slots) {
+    // allocate one shared memory segment for every table followed by the backend area using mmap,
+    // threads use a private mapping instead, --shm puts the segment in one named object
+    int nsems = ntables * NSEMS; // every table has its own semaphores
+    table_size = shared_mem_layout(NULL, nsmokers, nitems, depth);
+    size_t sync_size = (backend->area_size(nsems) + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+    size_t log_size = verbosity > LOG_NONE ? event_log_size(LOG_CAPACITY) : 0; // event log follows the backend area
+    size_t log_end = (ntables * table_size + sync_size + log_size + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+    size_t trace_size = trace_path ? (size_t) ntables * (nsmokers + 1) * sizeof(struct trace_buffer) : 0; // after the log
+    mem_size = trace_size ? log_end + trace_size : ntables * table_size + sync_size + log_size;
+    uint64_t setup_faults = page_faults();
+    if (segment_name != NULL) {
+        mem = create_named_segment(mem_size, prefault && numa_node < 0, &mapped_size);
+    } else {
+        mem = map_segment(mem_size, prefault && numa_node < 0, &mapped_size); // populated after binding otherwise
+    }
+    if (mem == NULL) {
+        exit(1);
+    }
+    if (numa_node >= 0 && bind_to_node(mem, mapped_size) == -1) { // before the first touch
+        exit(1);
+    }
+    if (prefault) {
+        prefault_segment(mem, mapped_size, 1);
+    }
+    setup_faults = page_faults() - setup_faults;
+
+    // memory is zero-filled, so tables are empty and rounds completed is 0
+    for (int t = 0; t < ntables; t++) { // loop through tables
+        struct shared_mem *table = table_at(t);
+        shared_mem_layout(table, nsmokers, nitems, depth);
+        table->index = t;
+        table->sem_base = t * NSEMS;
+        table->sync_offset = (ntables - t) * table_size; // backend area follows the last table
+        if (trace_size > 0) { // one buffer per smoker and one for the agent
+            table->trace_offset = log_end + t * (nsmokers + 1) * sizeof(struct trace_buffer) - t * table_size;
+        }
+        for (int i = 0; nweights > 0 && i < nsmokers; i++) { // weights repeat if fewer were given
+            mem_mailbox(table, i)->weight = weights[i % nweights];
+        }
+        for (int i = 0; open_slots && i < nsmokers; i++) { // nobody has joined yet
+            atomic_store(&mem_mailbox(table, i)->state, SLOT_FREE);
+        }
+    }
+
+    event_log = NULL;
+    if (log_size > 0) {
+        event_log = (struct event_log *) ((char *) mem + ntables * table_size + sync_size);
+        event_log_init(event_log, LOG_CAPACITY);
+    }
+
+    // create semaphores, agent semaphores are then set to the number of free slots and smoker semaphores stay 0,
+    // with --pull agent semaphores stay 0 too and every smoker posts its own once it is idle
+    if (backend->create(mem_sync(mem), nsems) == -1) {
+        exit(1);
+    }
+    int *agent_sems = calloc(ntables, sizeof(int));
+    if (agent_sems == NULL) {
+        perror("calloc");
+        exit(1);
+    }
+    for (int t = 0; t < ntables; t++) { // loop through tables
+        agent_sems[t] = AGENT_SEM(table_at(t));
+    }
+    if (!pull && sync_post_batch(agent_sems, ntables, depth) == -1) {
+        exit(1);
+    }
+    free(agent_sems);
+
+    // stamp the segment as complete, then make a named segment visible under its final name
+    struct shared_mem *first = table_at(0);
+    first->version = SEGMENT_VERSION;
+    first->tables = ntables;
+    first->segment_size = mem_size;
+    first->log_offset = event_log != NULL ? (size_t) ((char *) event_log - (char *) mem) : 0;
+    snprintf(first->backend, sizeof(first->backend), "%s", backend->name);
+    first->log_level = event_log != NULL ? verbosity : LOG_NONE;
+    first->pull = pull;
+    first->pickup = release_at_pickup;
+    atomic_store(&first->magic, SEGMENT_MAGIC);
+    if (segment_name != NULL && publish_segment() == -1) {
+        exit(1);
+    }
+    return setup_faults;
+}
+
+// function to run ntables independent groups of an agent and smokers, fills result if it is not NULL
+void run_group(struct run_result *result) {
+    uint64_t group_start = now_ns();
+    int nsems = ntables * NSEMS; // every table has its own semaphores
+    uint64_t setup_faults = create_group(0);
+
+    printf("Using %s backend, %d table(s), %d smokers, %d items, depth %d%s",
+           backend->name, ntables, nsmokers, nitems, depth, threads ? ", threads" : "");
+    if (workers > 0) {
+        printf(", %d smoker worker(s)", workers);
+    }
+    printf(", %s%s%s policy, seed %lu.\n", pull ? "pull, " : "", release_at_pickup ? "release at pickup, " : "", policy->name, (unsigned long) seed); // the seed reproduces the run
+    if (hugepages || prefault) {
+        printf("Segment of %zu KiB on %s pages, %s, %lu page faults while setting it up.\n", mapped_size / 1024,
+               segment_huge ? "huge" : "normal", segment_locked ? "locked" : prefault ? "prefaulted" : "faulted on demand",
+               (unsigned long) setup_faults);
+    }
+    fflush(stdout); // do not duplicate buffered output in children
+
+    // start smokers and agent of every table as child processes or threads
+    if (bench) {
+        perf_start(); // counters are inherited by the children and threads
+    }
+    pid_t writer = -1; // process rendering the event log
+    pthread_t writer_thread;
+    if (event_log != NULL) {
+        if (threads) {
+            int error = pthread_create(&writer_thread, NULL, log_writer_thread, NULL);
+            if (error != 0) { // check for errors
+                fprintf(stderr, "pthread_create: %s\n", strerror(error));
+                exit(1);
+            }
+        } else {
+            writer = start_log_writer();
+        }
+    }
+    long switches, end_switches;
+    uint64_t cpu_ns, end_cpu_ns;
+    group_usage(&switches, &cpu_ns);
+    uint64_t start = now_ns();
+    if (threads) {
+        run_threads();
+    } else {
+        run_processes(nsems);
+    }
+    double elapsed = (now_ns() - start) / 1e9;
+    group_usage(&end_switches, &end_cpu_ns);
+    switches = end_switches - switches;
+    cpu_ns = end_cpu_ns - cpu_ns;
+    if (event_log != NULL) { // let the writer drain the rest of the log
+        atomic_store(&event_log->closed, 1);
+        if (threads) {
+            pthread_join(writer_thread, NULL);
+        } else {
+            waitpid(writer, NULL, 0);
+        }
+    }
+    long long counters[PERF_EVENTS] = {-1, -1};
+    if (bench) {
+        perf_stop(counters);
+    }
+
+    // print statistics per table and in total
+    uint64_t rounds = 0;
+    for (int t = 0; t < ntables; t++) { // loop through tables
+        struct shared_mem *table = table_at(t);
+        uint64_t done_rounds = table_rounds(table);
+        double table_elapsed = (table->finish_ns - start) / 1e9;
+        if (ntables > 1) {
+            printf("table %d: %lu rounds in %.3f s, %.1f rounds/sec.\n", t, (unsigned long) done_rounds,
+                   table_elapsed, table_elapsed > 0 ? done_rounds / table_elapsed : 0);
+        }
+        rounds += done_rounds;
+    }
+    double rate = elapsed > 0 ? rounds / elapsed : 0;
+    printf("%lu rounds in %.3f s, %.1f rounds/sec.\n", (unsigned long) rounds, elapsed, rate);
+    if (backend->report != NULL) {
+        backend->report(rounds);
+    }
+    if (hugepages || prefault) {
+        uint64_t setup_faults = 0, faults = 0;
+        for (int t = 0; t < ntables; t++) { // sum faults of all tables
+            setup_faults += atomic_load(&table_at(t)->setup_faults);
+            faults += atomic_load(&table_at(t)->faults);
+        }
+        printf("%lu page faults in agents and smokers while they set up, %lu after their first wait, %.4f per round.\n",
+               (unsigned long) setup_faults, (unsigned long) faults, rounds ? (double) faults / rounds : 0.0);
+    }
+    uint64_t spin_waits = 0, spin_hits = 0, spin_iterations = 0;
+    for (int t = 0; t < ntables; t++) { // sum spin counters of all tables
+        spin_waits += atomic_load(&table_at(t)->spin.waits);
+        spin_hits += atomic_load(&table_at(t)->spin.hits);
+        spin_iterations += atomic_load(&table_at(t)->spin.spins);
+    }
+    if (spin_waits > 0) {
+        printf("spin: %.1f%% of %lu waits ended while spinning, %.1f iterations per wait, "
+               "CPU %.2f us per round (%.0f%% of wall time).\n",
+               100.0 * spin_hits / spin_waits, (unsigned long) spin_waits, (double) spin_iterations / spin_waits,
+               rounds ? cpu_ns / 1e3 / rounds : 0.0, elapsed > 0 ? cpu_ns / 1e7 / elapsed : 0.0);
+    }
+
+    // keep results after shared memory is removed
+    if (result != NULL) {
+        memset(result, 0, sizeof(*result));
+        result->rounds = rounds;
+        result->rate = rate;
+        result->context_switches = switches;
+        result->cpu_ns = cpu_ns;
+        for (int t = 0; t < ntables; t++) { // earliest first round of all tables
+            uint64_t first_round = atomic_load(&table_at(t)->first_round_ns);
+            if (first_round != 0 && (result->startup_ns == 0 || first_round - group_start < result->startup_ns)) {
+                result->startup_ns = first_round - group_start;
+            }
+        }
+        result->spin_waits = spin_waits;
+        result->spin_hits = spin_hits;
+        memcpy(result->perf, counters, sizeof(counters));
+        for (int t = 0; t < ntables; t++) { // merge histograms of all tables
+            for (int k = 0; k < LAT_KINDS; k++) {
+                hist_merge(&result->hist[k], &table_at(t)->hist[k]);
+            }
+        }
+    }
+    print_fairness(result);
+    if (trace_path != NULL) {
+        trace_export(trace_path);
+    }
+
+    cleanup(); // remove resources before the next group
+}
+
+// main function
+int main(int argc, char *argv[]) {
+    parse_options(argc, argv);
+    if (!seed_set && !bench) { // benchmarks keep the fixed seed so every run makes the same choices
+        seed = now_ns() ^ getpid();
+    }
+    if (role == ROLE_SMOKER) { // a smoker owns nothing, the agent removes the segment
+        return run_smoker_role(ingredient, rounds_set ? max_rounds : 0) == -1 ? 1 : 0;
+    }
+    if (role == ROLE_MONITOR) { // a monitor only reads the segment
+        return run_monitor_role() == -1 ? 1 : 0;
+    }
+    if (bench && !smoke_set) { // measure synchronization only unless a service time is requested
+        set_service_zero();
+    }
+    if (bench) { // nothing is logged while measuring
+        verbosity = LOG_NONE;
+    }
+
+    // register signal handler for keyboard interrupt
+    signal(SIGINT, sigint_handler);
+
+    // register the snapshot handler without SA_RESTART, so it interrupts the wait of the supervisor of processes
+    if (trace_path != NULL && role == ROLE_GROUP && !threads) {
+        struct sigaction action = {0};
+        action.sa_handler = sigusr1_handler;
+        sigemptyset(&action.sa_mask);
+        if (sigaction(SIGUSR1, &action, NULL) == -1) {
+            perror("sigaction");
+            exit(1);
+        }
+    }
+
+    // register cleanup function to be called at exit
+    owner_pid = getpid();
+    atexit(cleanup);
+
+    if (role == ROLE_AGENT) {
+        run_agent_role();
+        return 0;
+    }
+
+    if (bench) {
+        if (!rounds_set) { // ten rounds are not enough for percentiles
+            max_rounds = 100000;
+        }
+        find_bench(bench_name)->run();
+        return 0;
+    }
+
+    if (sweep_depth == 0) {
+        run_group(NULL);
+        return 0;
+    }
+
+    run_depth_sweep(sweep_depth);
+    return 0;
+}
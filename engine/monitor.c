@@ -0,0 +1,212 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "smokers.h"
+
+// interval between samples selected with --interval, in milliseconds
+int monitor_interval_ms = 1000;
+
+// text-format file rewritten every sample selected with --prometheus, NULL refreshes the terminal instead
+const char *prometheus_path = NULL;
+
+static const char *const slot_names[] = {"free", "joining", "active", "leaving", "retired", "dead"};
+
+// counters of one smoker at the previous sample
+struct smoker_sample {
+    uint64_t served; // rounds smoked
+    uint64_t waits; // number of waits
+    uint64_t wait_ns; // total time waited
+};
+
+// function to get table t of an attached segment, tables are as far apart as the first table is from the backend area
+static struct shared_mem *monitor_table(struct shared_mem *first, int t) {
+    return (struct shared_mem *) ((char *) first + t * (first->sync_offset / first->tables));
+}
+
+// function to read a semaphore of a table, -1 if the backend cannot read it without changing it
+// or the agent is done and may have removed the semaphores already
+static int sem_value(struct shared_mem *table, int sem) {
+    return backend->value != NULL && !table->done ? backend->value(sem) : -1;
+}
+
+// function to format a semaphore value for the screen, "-" if it could not be read
+static const char *sem_text(char *text, size_t size, int value) {
+    if (value < 0) {
+        return "-";
+    }
+    snprintf(text, size, "%d", value);
+    return text;
+}
+
+// function to print one sample of every table as a screen which replaces the previous one on a terminal
+static void print_screen(struct shared_mem *first, struct smoker_sample *last, double elapsed) {
+    if (isatty(STDOUT_FILENO)) {
+        printf("\033[H\033[2J"); // home and clear
+    }
+    printf("%s: %d table(s), %s backend%s%s, every %d ms.\n", segment_name, first->tables, first->backend,
+           first->pull ? ", pull" : "", first->pickup ? ", release at pickup" : "", monitor_interval_ms);
+    for (int t = 0; t < first->tables; t++) { // loop through tables
+        struct shared_mem *table = monitor_table(first, t);
+        uint64_t rounds = table_rounds(table);
+        uint64_t previous = 0;
+        for (int i = 0; i < table->smokers; i++) {
+            previous += last[t * table->smokers + i].served;
+        }
+        char text[16];
+        printf("table %d: %lu rounds, %.1f rounds/sec, agent semaphore %s%s\n", t, (unsigned long) rounds,
+               elapsed > 0 ? (rounds - previous) / elapsed : 0.0,
+               sem_text(text, sizeof(text), sem_value(table, AGENT_SEM(table))), table->done ? ", done" : "");
+        printf("  %5s %-8s %10s %9s %12s %12s %4s  %s\n", "slot", "state", "served", "rounds/s", "mean wait us",
+               "p99 wait us", "sem", "item");
+        for (int i = 0; i < table->smokers; i++) { // loop through slots
+            struct mailbox *box = mem_mailbox(table, i);
+            struct smoker_sample *sample = &last[t * table->smokers + i];
+            int state = atomic_load_explicit(&box->state, memory_order_relaxed);
+            if (state == SLOT_FREE) {
+                continue;
+            }
+            uint64_t served = atomic_load_explicit(&box->served, memory_order_relaxed);
+            uint64_t waits = box->wait.count - sample->waits;
+            printf("  %5d %-8s %10lu %9.1f %12.1f %12.1f %4s  ", i, slot_names[state], (unsigned long) served,
+                   elapsed > 0 ? (served - sample->served) / elapsed : 0.0,
+                   waits ? (box->wait.sum_ns - sample->wait_ns) / 1e3 / waits : 0.0,
+                   wait_percentile(&box->wait, 0.99) / 1e3,
+                   sem_text(text, sizeof(text), sem_value(table, SMOKER_SEM(table, i))));
+            fprint_item_name(stdout, box->item);
+            printf("\n");
+        }
+    }
+    fflush(stdout);
+}
+
+// function to write one sample of every table in the Prometheus text format,
+// to a temporary file renamed over path so a scraper never reads half of it
+static int write_prometheus(const char *path, struct shared_mem *first, struct smoker_sample *last, double elapsed) {
+    char temp[4096];
+    snprintf(temp, sizeof(temp), "%s.tmp", path);
+    FILE *out = fopen(temp, "w");
+    if (out == NULL) { // check for errors
+        perror(temp);
+        return -1;
+    }
+    fprintf(out, "# HELP smokers_rounds_total Rounds smoked.\n# TYPE smokers_rounds_total counter\n");
+    for (int t = 0; t < first->tables; t++) {
+        fprintf(out, "smokers_rounds_total{table=\"%d\"} %lu\n", t, (unsigned long) table_rounds(monitor_table(first, t)));
+    }
+    fprintf(out, "# HELP smokers_rounds_per_second Rounds smoked per second over the last interval.\n"
+            "# TYPE smokers_rounds_per_second gauge\n");
+    for (int t = 0; t < first->tables; t++) {
+        struct shared_mem *table = monitor_table(first, t);
+        uint64_t previous = 0;
+        for (int i = 0; i < table->smokers; i++) {
+            previous += last[t * table->smokers + i].served;
+        }
+        fprintf(out, "smokers_rounds_per_second{table=\"%d\"} %.3f\n", t,
+                elapsed > 0 ? (table_rounds(table) - previous) / elapsed : 0.0);
+    }
+    fprintf(out, "# HELP smokers_served_total Rounds smoked per smoker slot.\n# TYPE smokers_served_total counter\n");
+    for (int t = 0; t < first->tables; t++) {
+        struct shared_mem *table = monitor_table(first, t);
+        for (int i = 0; i < table->smokers; i++) {
+            fprintf(out, "smokers_served_total{table=\"%d\",slot=\"%d\"} %lu\n", t, i,
+                    (unsigned long) atomic_load_explicit(&mem_mailbox(table, i)->served, memory_order_relaxed));
+        }
+    }
+    fprintf(out, "# HELP smokers_wait_seconds Time smokers waited for their items between rounds.\n"
+            "# TYPE smokers_wait_seconds summary\n");
+    for (int t = 0; t < first->tables; t++) {
+        struct shared_mem *table = monitor_table(first, t);
+        for (int i = 0; i < table->smokers; i++) {
+            struct wait_stats *wait = &mem_mailbox(table, i)->wait;
+            fprintf(out, "smokers_wait_seconds{table=\"%d\",slot=\"%d\",quantile=\"0.99\"} %.9f\n", t, i,
+                    wait_percentile(wait, 0.99) / 1e9);
+            fprintf(out, "smokers_wait_seconds_sum{table=\"%d\",slot=\"%d\"} %.9f\n", t, i, wait->sum_ns / 1e9);
+            fprintf(out, "smokers_wait_seconds_count{table=\"%d\",slot=\"%d\"} %lu\n", t, i,
+                    (unsigned long) wait->count);
+        }
+    }
+    if (backend->value != NULL) {
+        fprintf(out, "# HELP smokers_semaphore_value Current value of the semaphores of a table.\n"
+                "# TYPE smokers_semaphore_value gauge\n");
+        for (int t = 0; t < first->tables; t++) {
+            struct shared_mem *table = monitor_table(first, t);
+            if (table->done) { // the semaphores may be gone
+                continue;
+            }
+            fprintf(out, "smokers_semaphore_value{table=\"%d\",semaphore=\"agent\"} %d\n", t,
+                    sem_value(table, AGENT_SEM(table)));
+            for (int i = 0; i < table->smokers; i++) {
+                fprintf(out, "smokers_semaphore_value{table=\"%d\",semaphore=\"smoker\",slot=\"%d\"} %d\n", t, i,
+                        sem_value(table, SMOKER_SEM(table, i)));
+            }
+        }
+    }
+    if (fclose(out) == EOF) {
+        perror(temp);
+        return -1;
+    }
+    if (rename(temp, path) == -1) { // check for errors
+        perror(path);
+        return -1;
+    }
+    return 0;
+}
+
+// function to remember the counters of every smoker for the next sample
+static void remember(struct shared_mem *first, struct smoker_sample *last) {
+    for (int t = 0; t < first->tables; t++) { // loop through tables
+        struct shared_mem *table = monitor_table(first, t);
+        for (int i = 0; i < table->smokers; i++) { // loop through slots
+            struct mailbox *box = mem_mailbox(table, i);
+            struct smoker_sample *sample = &last[t * table->smokers + i];
+            sample->served = atomic_load_explicit(&box->served, memory_order_relaxed);
+            sample->waits = box->wait.count;
+            sample->wait_ns = box->wait.sum_ns;
+        }
+    }
+}
+
+// function to watch a named segment read-only until every agent is done, sampling every monitor_interval_ms
+// only counters the agent and smokers keep anyway are read, so the hot path does no extra work
+int run_monitor_role(void) {
+    size_t mapped;
+    struct shared_mem *first = attach_segment(&mapped, 0); // nothing in the segment is written
+    if (first == NULL) {
+        return -1;
+    }
+    backend = find_backend(first->backend);
+    if (backend == NULL || backend->attach(mem_sync(first), first->tables * (first->smokers + 1)) == -1) {
+        fprintf(stderr, "%s: cannot read the semaphores of the %s backend\n", segment_name, first->backend);
+        return -1;
+    }
+    struct smoker_sample *last = calloc((size_t) first->tables * first->smokers, sizeof(struct smoker_sample));
+    if (last == NULL) {
+        perror("calloc");
+        return -1;
+    }
+    remember(first, last);
+    struct timespec interval = {monitor_interval_ms / 1000, monitor_interval_ms % 1000 * 1000000L};
+    uint64_t sampled = now_ns();
+    int done = 0;
+    while (!done) {
+        nanosleep(&interval, NULL);
+        uint64_t now = now_ns();
+        double elapsed = (now - sampled) / 1e9;
+        sampled = now;
+        done = 1;
+        for (int t = 0; t < first->tables; t++) { // the last sample shows the final counters
+            done = done && monitor_table(first, t)->done;
+        }
+        if (prometheus_path == NULL) {
+            print_screen(first, last, elapsed);
+        } else if (write_prometheus(prometheus_path, first, last, elapsed) == -1) {
+            free(last);
+            return -1;
+        }
+        remember(first, last);
+    }
+    free(last);
+    return 0;
+}
@@ -0,0 +1,69 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "smokers.h"
+
+// hardware events counted around a benchmark run
+static const struct {
+    const char *name; // name in the report
+    __u64 config; // PERF_COUNT_HW_* event
+} events[PERF_EVENTS] = {
+    {"cache-references", PERF_COUNT_HW_CACHE_REFERENCES},
+    {"cache-misses", PERF_COUNT_HW_CACHE_MISSES},
+};
+
+static int fds[PERF_EVENTS] = {-1, -1}; // perf event descriptors, -1 if unavailable
+
+// function to start counting events in the calling process and every child forked after this call
+void perf_start(void) {
+    for (int i = 0; i < PERF_EVENTS; i++) { // loop through events
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = events[i].config;
+        attr.disabled = 1; // enabled below, after all events are opened
+        attr.inherit = 1; // counts of children are added when they exit
+        attr.exclude_hv = 1;
+        fds[i] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0); // this process, any CPU
+    }
+    for (int i = 0; i < PERF_EVENTS; i++) {
+        if (fds[i] != -1) {
+            ioctl(fds[i], PERF_EVENT_IOC_RESET, 0);
+            ioctl(fds[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+}
+
+// function to stop counting, values are -1 for events which could not be counted
+void perf_stop(long long values[PERF_EVENTS]) {
+    for (int i = 0; i < PERF_EVENTS; i++) { // loop through events
+        values[i] = -1;
+        if (fds[i] == -1) {
+            continue;
+        }
+        ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0);
+        if (read(fds[i], &values[i], sizeof(values[i])) != sizeof(values[i])) { // check for errors
+            values[i] = -1;
+        }
+        close(fds[i]);
+        fds[i] = -1;
+    }
+}
+
+// function to print counted events per round
+void perf_print(const char *label, long long values[PERF_EVENTS], uint64_t rounds) {
+    printf("%-22s", label);
+    for (int i = 0; i < PERF_EVENTS; i++) { // loop through events
+        if (values[i] < 0) {
+            printf(" %s: n/a", events[i].name);
+        } else {
+            printf(" %s: %.2f/round", events[i].name, rounds ? (double) values[i] / rounds : 0.0);
+        }
+    }
+    printf("\n");
+}
@@ -0,0 +1,227 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "smokers.h"
+
+// function to get the number of rounds posted to a smoker which it has not finished yet
+static uint64_t in_flight(struct schedule *schedule, int smoker) {
+    struct mailbox *box = mem_mailbox(schedule->mem, smoker);
+    uint64_t finished = atomic_load_explicit(&box->served, memory_order_relaxed) +
+                        atomic_load_explicit(&box->returned, memory_order_relaxed);
+    return schedule->posted[smoker] - finished;
+}
+
+// function to get whether a smoker may get a round: always when pushing, only while it is idle with --pull
+static int can_take(struct schedule *schedule, int smoker) {
+    return !pull || is_ready(schedule->mem, smoker);
+}
+
+// function to get the relative deadline of a smoker, heavier smokers must be served sooner
+static uint64_t relative_deadline(struct schedule *schedule, int smoker) {
+    return deadline_ns / schedule->weight[smoker];
+}
+
+// function to pick a random missing item, then the smokers which have it in turn (the homework agent)
+// items are drawn RNG_BATCH at a time, so the generator runs once per batch instead of once per round
+static int pick_random(struct schedule *schedule) {
+    int items = schedule->mem->items;
+    if (schedule->drawn == RNG_BATCH) { // refill the batch
+        for (int i = 0; i < RNG_BATCH; i++) {
+            schedule->batch[i] = (uint8_t) rng_bounded(&schedule->rng, items);
+        }
+        schedule->drawn = 0;
+    }
+    int item = schedule->batch[schedule->drawn++]; // random item, or the next one which has a smoker who may take it
+    for (int i = 0; i < items; i++, item = (item + 1) % items) { // loop through items
+        for (int j = 0; j < schedule->count[item]; j++) { // smokers with the item, starting at their turn
+            int smoker = schedule->routes[item][schedule->turn[item]];
+            schedule->turn[item] = (schedule->turn[item] + 1) % schedule->count[item];
+            if (can_take(schedule, smoker)) {
+                return smoker;
+            }
+        }
+    }
+    return -1;
+}
+
+// function to pick every active smoker in turn
+static int pick_round_robin(struct schedule *schedule) {
+    for (int i = 0; i < schedule->nactive; i++) { // loop through active smokers from the current position
+        int smoker = schedule->active[schedule->next];
+        schedule->next = (schedule->next + 1) % schedule->nactive;
+        if (can_take(schedule, smoker)) {
+            return smoker;
+        }
+    }
+    return -1;
+}
+
+// function to pick smokers in proportion to their weights with smooth weighted round-robin:
+// every smoker earns its weight, the richest one is picked and pays the total weight
+static int pick_weighted(struct schedule *schedule) {
+    int best = -1;
+    int64_t total = 0;
+    for (int i = 0; i < schedule->nactive; i++) { // loop through active smokers
+        int smoker = schedule->active[i];
+        if (!can_take(schedule, smoker)) { // a busy smoker keeps its credit
+            continue;
+        }
+        schedule->credit[smoker] += schedule->weight[smoker];
+        total += schedule->weight[smoker];
+        if (best == -1 || schedule->credit[smoker] > schedule->credit[best]) {
+            best = smoker;
+        }
+    }
+    if (best != -1) {
+        schedule->credit[best] -= total;
+    }
+    return best;
+}
+
+// function to pick the smoker with the fewest rounds in flight and the smallest key among them,
+// the key is the time the smoker became idle plus the given relative deadline
+static int pick_earliest(struct schedule *schedule, int use_deadline) {
+    int best = -1;
+    uint64_t best_flight = 0, best_key = 0;
+    for (int i = 0; i < schedule->nactive; i++) { // loop through active smokers
+        int smoker = schedule->active[i];
+        if (!can_take(schedule, smoker)) {
+            continue;
+        }
+        uint64_t flight = in_flight(schedule, smoker);
+        uint64_t key = atomic_load_explicit(&mem_mailbox(schedule->mem, smoker)->wait.idle_since_ns,
+                                            memory_order_relaxed);
+        if (use_deadline) {
+            key += relative_deadline(schedule, smoker);
+        }
+        if (best == -1 || flight < best_flight || (flight == best_flight && key < best_key)) {
+            best = smoker;
+            best_flight = flight;
+            best_key = key;
+        }
+    }
+    return best;
+}
+
+// function to pick the smoker which has waited longest since its last round
+static int pick_least_recent(struct schedule *schedule) {
+    return pick_earliest(schedule, 0);
+}
+
+// function to pick the smoker whose deadline comes first
+static int pick_deadline(struct schedule *schedule) {
+    return pick_earliest(schedule, 1);
+}
+
+static const struct agent_policy random_policy = {"random", pick_random};
+static const struct agent_policy round_robin_policy = {"round-robin", pick_round_robin};
+static const struct agent_policy weighted_policy = {"weighted", pick_weighted};
+static const struct agent_policy lrs_policy = {"lrs", pick_least_recent};
+static const struct agent_policy edf_policy = {"edf", pick_deadline};
+
+// table of all scheduling policies
+const struct agent_policy *const policies[] = {
+    &random_policy,
+    &round_robin_policy,
+    &weighted_policy,
+    &lrs_policy,
+    &edf_policy,
+};
+
+const int npolicies = sizeof(policies) / sizeof(policies[0]);
+
+// function to find a scheduling policy by name, returns NULL if there is none
+const struct agent_policy *find_policy(const char *name) {
+    for (int i = 0; i < npolicies; i++) { // loop through policies
+        if (strcmp(policies[i]->name, name) == 0) {
+            return policies[i];
+        }
+    }
+    return NULL;
+}
+
+// function to print the names of all scheduling policies separated by '|'
+void print_policy_names(void) {
+    for (int i = 0; i < npolicies; i++) {
+        printf("%s%s", i ? "|" : "", policies[i]->name);
+    }
+}
+
+// function to allocate the schedule of a table, returns -1 on errors
+int schedule_init(struct schedule *schedule, struct shared_mem *mem) {
+    int smokers = mem->smokers;
+    memset(schedule, 0, sizeof(*schedule));
+    schedule->mem = mem;
+    schedule->count = calloc(mem->items, sizeof(int));
+    schedule->turn = calloc(mem->items, sizeof(int));
+    schedule->active = calloc(smokers, sizeof(int));
+    schedule->item = calloc(smokers, sizeof(int));
+    schedule->weight = calloc(smokers, sizeof(int));
+    schedule->credit = calloc(smokers, sizeof(int64_t));
+    schedule->posted = calloc(smokers, sizeof(uint64_t));
+    if (schedule->count == NULL || schedule->turn == NULL || schedule->active == NULL || schedule->item == NULL ||
+        schedule->weight == NULL || schedule->credit == NULL || schedule->posted == NULL) {
+        perror("calloc");
+        return -1;
+    }
+    rng_seed(&schedule->rng, seed, mem->index); // one stream per table
+    schedule->drawn = RNG_BATCH; // the first pick draws a batch
+    schedule->routes = build_routes(smokers, mem->items, schedule->count);
+    return schedule->routes == NULL ? -1 : 0;
+}
+
+// function to rebuild the schedule from the active smoker slots of its table
+void schedule_update(struct schedule *schedule) {
+    struct shared_mem *mem = schedule->mem;
+    update_routes(mem, schedule->routes, schedule->count);
+    schedule->nactive = 0;
+    for (int i = 0; i < mem->smokers; i++) { // loop through slots
+        struct mailbox *box = mem_mailbox(mem, i);
+        schedule->item[i] = box->item;
+        schedule->weight[i] = box->weight > 0 ? box->weight : 1;
+        schedule->credit[i] = 0;
+        if (atomic_load(&box->state) == SLOT_ACTIVE) {
+            schedule->active[schedule->nactive++] = i;
+        }
+    }
+    schedule->next = 0;
+    for (int item = 0; item < mem->items; item++) {
+        schedule->turn[item] = 0;
+    }
+}
+
+// function to release the schedule of a table
+void schedule_free(struct schedule *schedule) {
+    for (int item = 0; item < schedule->mem->items; item++) {
+        free(schedule->routes[item]);
+    }
+    free(schedule->routes);
+    free(schedule->count);
+    free(schedule->turn);
+    free(schedule->active);
+    free(schedule->item);
+    free(schedule->weight);
+    free(schedule->credit);
+    free(schedule->posted);
+}
+
+// function to check whether the next round of a smoker is delivered after its deadline,
+// only a smoker which is idle waits for it
+int deadline_missed(struct schedule *schedule, int smoker, uint64_t now) {
+    if (in_flight(schedule, smoker) > 0) {
+        return 0;
+    }
+    uint64_t idle_since = atomic_load_explicit(&mem_mailbox(schedule->mem, smoker)->wait.idle_since_ns,
+                                               memory_order_relaxed);
+    return now > idle_since + relative_deadline(schedule, smoker);
+}
+
+// function to get the number of rounds posted to the smokers of a table which they have not finished yet
+uint64_t schedule_in_flight(struct schedule *schedule) {
+    uint64_t total = 0;
+    for (int i = 0; i < schedule->mem->smokers; i++) { // loop through slots
+        total += in_flight(schedule, i);
+    }
+    return total;
+}
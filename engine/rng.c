@@ -0,0 +1,41 @@
+#include <stdio.h>
+
+#include "smokers.h"
+
+// function to seed a generator, generators with the same seed and different streams give independent sequences
+void rng_seed(struct rng *rng, uint64_t seed, uint64_t stream) {
+    rng->state = 0;
+    rng->inc = (stream << 1) | 1; // the increment must be odd
+    rng_next(rng);
+    rng->state += seed;
+    rng_next(rng);
+}
+
+// function to get the next 32 random bits with PCG-XSH-RR: a 64-bit LCG step, then a xorshift and a random rotation
+uint32_t rng_next(struct rng *rng) {
+    uint64_t old = rng->state;
+    rng->state = old * 6364136223846793005ULL + rng->inc;
+    uint32_t xorshifted = (uint32_t) (((old >> 18) ^ old) >> 27);
+    uint32_t rot = (uint32_t) (old >> 59);
+    return (xorshifted >> rot) | (xorshifted << ((-rot) & 31));
+}
+
+// function to get a uniform number in [0, range) with Lemire's multiply-shift, rejecting the few biased values
+uint32_t rng_bounded(struct rng *rng, uint32_t range) {
+    uint64_t product = (uint64_t) rng_next(rng) * range;
+    uint32_t low = (uint32_t) product;
+    if (low < range) {
+        uint32_t threshold = -range % range; // 2^32 mod range
+        while (low < threshold) {
+            product = (uint64_t) rng_next(rng) * range;
+            low = (uint32_t) product;
+        }
+    }
+    return (uint32_t) (product >> 32);
+}
+
+// function to get a uniform double in [0, 1) with 53 random bits
+double rng_double(struct rng *rng) {
+    uint64_t bits = ((uint64_t) rng_next(rng) << 32) | rng_next(rng);
+    return (bits >> 11) * 0x1.0p-53;
+}
@@ -0,0 +1,183 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#include "smokers.h"
+
+static struct shared_mem *joined; // table the smoker joined
+static struct mailbox *slot_box; // mailbox of the slot the smoker holds
+static volatile sig_atomic_t leave_requested = 0; // set once the smoker asked to leave
+
+// set by --role=agent while its watchdog looks for smokers which exited without leaving
+int watchdog = 0;
+
+// function to get whether any slot of a table still has a smoker
+static int slots_in_use(struct shared_mem *table) {
+    for (int i = 0; i < table->smokers; i++) { // loop through slots
+        if (atomic_load(&mem_mailbox(table, i)->state) != SLOT_FREE) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// function to look for smokers which exited without leaving every 100 ms until the agent is done:
+// their slot is marked dead and the agent is woken to hand back what they held and free it
+static void *watchdog_thread(void *arg) {
+    struct shared_mem *table = arg;
+    struct timespec interval = {0, 100000000}; // 100 ms
+    while (!table->done) {
+        nanosleep(&interval, NULL);
+        for (int i = 0; i < table->smokers; i++) { // loop through slots
+            struct mailbox *box = mem_mailbox(table, i);
+            int state = atomic_load(&box->state);
+            pid_t owner = atomic_load(&box->owner); // 0 until a joining smoker filled its slot
+            if (state == SLOT_FREE || state == SLOT_DEAD || owner == 0 || kill(owner, 0) == 0 || errno != ESRCH) {
+                continue;
+            }
+            if (atomic_compare_exchange_strong(&box->state, &state, SLOT_DEAD)) { // unless it left meanwhile
+                atomic_fetch_add(&table->members, 1);
+                atomic_fetch_add(&table->wakeups, 1); // before the post, so the agent never takes it for a round
+                if (backend->post(AGENT_SEM(table)) == -1) {
+                    exit(1);
+                }
+            }
+        }
+    }
+    return NULL;
+}
+
+// function to run only the agent of a named segment, smokers launched separately join and leave its slots
+void run_agent_role(void) {
+    ntables = 1; // smokers attach to the first table
+    create_group(1);
+    struct shared_mem *table = table_at(0);
+    printf("Agent of %s: %d smoker slots, %d items, depth %d, %s backend. Waiting for smokers.\n",
+           segment_name, nsmokers, nitems, depth, backend->name);
+    fflush(stdout);
+    pthread_t writer;
+    if (event_log != NULL && pthread_create(&writer, NULL, log_writer_thread, NULL) != 0) { // check for errors
+        perror("pthread_create");
+        exit(1);
+    }
+    watchdog = 1;
+    pthread_t checker;
+    if (pthread_create(&checker, NULL, watchdog_thread, table) != 0) { // check for errors
+        perror("pthread_create");
+        exit(1);
+    }
+    uint64_t start = now_ns();
+    agent(table);
+    pthread_join(checker, NULL);
+    double elapsed = (now_ns() - start) / 1e9;
+    struct timespec idle = {0, 1000000}; // 1 ms
+    for (int waited = 0; waited < 1000 && slots_in_use(table); waited++) { // let smokers detach before cleanup
+        nanosleep(&idle, NULL);
+    }
+    if (event_log != NULL) { // let the writer drain the rest of the log
+        atomic_store(&event_log->closed, 1);
+        pthread_join(writer, NULL);
+    }
+    uint64_t rounds = table_rounds(table);
+    printf("%lu rounds in %.3f s, %.1f rounds/sec.\n", (unsigned long) rounds, elapsed, elapsed > 0 ? rounds / elapsed : 0);
+    print_fairness(NULL);
+    if (trace_path != NULL) {
+        trace_export(trace_path);
+    }
+}
+
+// function to ask the agent to stop routing rounds to this smoker
+static void request_leave(void) {
+    int expected = SLOT_ACTIVE;
+    leave_requested = 1;
+    if (atomic_compare_exchange_strong(&slot_box->state, &expected, SLOT_LEAVING)) {
+        atomic_fetch_add(&joined->members, 1); // the agent notices it before the next round
+    }
+}
+
+// function to handle SIGINT and SIGTERM: the first one leaves gracefully, the second one exits at once
+static void leave_handler(int sig) {
+    if (leave_requested) {
+        _exit(1);
+    }
+    request_leave();
+}
+
+// function to join a group started with --role=agent as a smoker which has item,
+// until the agent ends, a signal asks it to leave or it smoked leave_after rounds (0 for no limit)
+int run_smoker_role(int item, int leave_after) {
+    size_t mapped;
+    struct shared_mem *table = attach_segment(&mapped, 1); // one shm_open and one mmap
+    if (table == NULL) {
+        return -1;
+    }
+    backend = find_backend(table->backend);
+    if (backend == NULL || table->tables != 1 || item >= table->items) { // check for errors
+        fprintf(stderr, "%s: cannot join with item %d\n", segment_name, item);
+        return -1;
+    }
+    event_log = table->log_offset ? (struct event_log *) ((char *) table + table->log_offset) : NULL;
+    verbosity = table->log_level;
+    pull = table->pull;
+    release_at_pickup = table->pickup;
+    if (backend->attach(mem_sync(table), table->smokers + 1) == -1) {
+        return -1;
+    }
+
+    // claim a free slot, fill it, then let the agent route rounds to it
+    int slot = -1;
+    for (int i = 0; i < table->smokers && slot == -1; i++) { // loop through slots
+        int expected = SLOT_FREE;
+        if (atomic_compare_exchange_strong(&mem_mailbox(table, i)->state, &expected, SLOT_JOINING)) {
+            slot = i;
+        }
+    }
+    if (slot == -1) {
+        fprintf(stderr, "%s: all %d smoker slots are taken\n", segment_name, table->smokers);
+        return -1;
+    }
+    joined = table;
+    slot_box = mem_mailbox(table, slot);
+    slot_box->item = item;
+    slot_box->weight = nweights > 0 ? weights[0] : 1;
+    atomic_store(&slot_box->owner, getpid());
+    struct smoker_state state;
+    smoker_init(&state, table, slot);
+    atomic_store(&slot_box->state, SLOT_ACTIVE);
+    atomic_fetch_add(&table->members, 1);
+    smoker_start(&state); // after the agent can see the slot
+    signal(SIGINT, leave_handler);
+    signal(SIGTERM, leave_handler);
+    printf("Smoker %d joined %s with ", slot, segment_name);
+    fprint_item_name(stdout, item);
+    printf(".\n");
+    fflush(stdout);
+
+    seed_service(STREAM_SMOKER(0, slot));
+    int served = 0;
+    while (1) {
+        if (leave_after > 0 && served == leave_after && !leave_requested) {
+            request_leave();
+        }
+        trace_step(state.trace, TR_WAIT, 0, 0);
+        if (sync_wait(SMOKER_SEM(table, slot)) == -1) { // wait for smoker semaphore
+            return -1;
+        }
+        int result = smoker_serve(&state);
+        if (result == 0) { // agent finished or retired the slot
+            break;
+        }
+        served += result == 1;
+    }
+    spin_flush(&table->spin);
+    atomic_store(&slot_box->owner, 0); // before the slot is free, so the watchdog never checks the next smoker by it
+    atomic_store(&slot_box->state, SLOT_FREE);
+    printf("Smoker %d left after %d rounds.\n", slot, served);
+    munmap(table, mapped);
+    return 0;
+}
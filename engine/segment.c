@@ -0,0 +1,213 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+
+#include "smokers.h"
+
+// set by --hugepages: back the segment with huge pages, falling back to normal pages
+int hugepages = 0;
+
+// set by --prefault: fault in and lock every page of the segment before the first round
+int prefault = 0;
+
+// name of the shared object selected with --shm, NULL keeps the segment anonymous
+const char *segment_name = NULL;
+
+static char temp_name[64]; // name of the object until it is published
+static __thread uint64_t setup_done_at; // page faults of this process or thread when its participant was set up
+
+// set when the current segment is backed by huge pages, and when it is locked in memory
+int segment_huge = 0;
+int segment_locked = 0;
+
+// function to get the default huge page size from /proc/meminfo, 2 MiB if it is not listed
+static size_t huge_page_size(void) {
+    FILE *file = fopen("/proc/meminfo", "r");
+    char line[128];
+    size_t kib = 2048;
+    if (file == NULL) {
+        return kib * 1024;
+    }
+    while (fgets(line, sizeof(line), file) != NULL) { // loop through lines
+        if (sscanf(line, "Hugepagesize: %zu kB", &kib) == 1) {
+            break;
+        }
+    }
+    fclose(file);
+    return kib * 1024;
+}
+
+// function to round size up to a multiple of unit
+static size_t round_up(size_t size, size_t unit) {
+    return (size + unit - 1) / unit * unit;
+}
+
+// function to map a zero-filled segment shared with children, or private to the process when it runs threads
+// mapped is set to the size to unmap, pages are populated at once if populate is set
+void *map_segment(size_t size, int populate, size_t *mapped) {
+    int flags = (threads ? MAP_PRIVATE : MAP_SHARED) | MAP_ANONYMOUS | (populate ? MAP_POPULATE : 0);
+    void *addr = MAP_FAILED;
+    segment_huge = 0;
+    segment_locked = 0;
+    if (hugepages) {
+        *mapped = round_up(size, huge_page_size());
+        addr = mmap(NULL, *mapped, PROT_READ | PROT_WRITE, flags | MAP_HUGETLB, -1, 0);
+        if (addr == MAP_FAILED) { // no huge pages reserved in /proc/sys/vm/nr_hugepages
+            fprintf(stderr, "mmap(MAP_HUGETLB): %s, using normal pages.\n", strerror(errno));
+        } else {
+            segment_huge = 1;
+        }
+    }
+    if (addr == MAP_FAILED) {
+        *mapped = round_up(size, sysconf(_SC_PAGESIZE));
+        addr = mmap(NULL, *mapped, PROT_READ | PROT_WRITE, flags, -1, 0);
+        if (addr == MAP_FAILED) { // check for errors
+            perror("mmap");
+            return NULL;
+        }
+        if (hugepages) { // transparent huge pages may still back it
+            madvise(addr, *mapped, MADV_HUGEPAGE);
+        }
+    }
+    return addr;
+}
+
+// function to create a shared object under a temporary name and map it, it is invisible until published
+void *create_named_segment(size_t size, int populate, size_t *mapped) {
+    snprintf(temp_name, sizeof(temp_name), "%s.%d.tmp", segment_name, (int) getpid());
+    int fd = shm_open(temp_name, O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd == -1) { // check for errors
+        perror(temp_name);
+        return NULL;
+    }
+    *mapped = round_up(size, sysconf(_SC_PAGESIZE));
+    segment_huge = 0;
+    segment_locked = 0;
+    void *addr = MAP_FAILED;
+    if (ftruncate(fd, *mapped) == -1) { // zero-filled object of the full size
+        perror("ftruncate");
+    } else {
+        addr = mmap(NULL, *mapped, PROT_READ | PROT_WRITE, MAP_SHARED | (populate ? MAP_POPULATE : 0), fd, 0);
+        if (addr == MAP_FAILED) {
+            perror("mmap");
+        }
+    }
+    close(fd);
+    if (addr == MAP_FAILED) {
+        shm_unlink(temp_name);
+        return NULL;
+    }
+    if (hugepages) { // shm_open objects cannot use MAP_HUGETLB, transparent huge pages may still back them
+        madvise(addr, *mapped, MADV_HUGEPAGE);
+    }
+    return addr;
+}
+
+// function to make the initialized segment visible under segment_name, replacing a stale object atomically
+int publish_segment(void) {
+    char from[96], to[96]; // POSIX shared memory objects live in /dev/shm on Linux
+    snprintf(from, sizeof(from), "/dev/shm%s", temp_name);
+    snprintf(to, sizeof(to), "/dev/shm%s", segment_name);
+    if (rename(from, to) == -1) { // check for errors
+        perror("rename");
+        shm_unlink(temp_name);
+        return -1;
+    }
+    return 0;
+}
+
+// function to map the object published under segment_name with one mmap, NULL if it is missing or incompatible
+// a monitor maps it without writable set, so it cannot disturb the group it watches
+void *attach_segment(size_t *mapped, int writable) {
+    int fd = shm_open(segment_name, writable ? O_RDWR : O_RDONLY, 0);
+    if (fd == -1) { // check for errors
+        perror(segment_name);
+        return NULL;
+    }
+    struct stat st;
+    void *addr = MAP_FAILED;
+    if (fstat(fd, &st) == -1) {
+        perror("fstat");
+    } else if ((size_t) st.st_size < sizeof(struct shared_mem)) {
+        fprintf(stderr, "%s: too small for a segment\n", segment_name);
+    } else {
+        addr = mmap(NULL, st.st_size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+        if (addr == MAP_FAILED) {
+            perror("mmap");
+        }
+    }
+    close(fd);
+    if (addr == MAP_FAILED) {
+        return NULL;
+    }
+    struct shared_mem *first = addr;
+    if (atomic_load(&first->magic) != SEGMENT_MAGIC || first->version != SEGMENT_VERSION ||
+        first->segment_size > (size_t) st.st_size) { // not a segment of this program or of another layout
+        fprintf(stderr, "%s: not a version %d segment\n", segment_name, SEGMENT_VERSION);
+        munmap(addr, st.st_size);
+        return NULL;
+    }
+    *mapped = st.st_size;
+    return addr;
+}
+
+// function to remove the object published under segment_name
+void unlink_segment(void) {
+    if (shm_unlink(segment_name) == -1 && errno != ENOENT) { // check for errors
+        perror(segment_name);
+    }
+}
+
+// function to fault in every page of the segment in the calling process and lock it there
+// write may be set only before the segment is in use, children touch pages by reading them
+void prefault_segment(void *addr, size_t size, int write) {
+    if (mlock(addr, size) == 0) { // locking faults in every page
+        segment_locked = 1;
+        return;
+    }
+    static int warned = 0;
+    if (!warned) { // RLIMIT_MEMLOCK is often small for unprivileged users
+        fprintf(stderr, "mlock: %s, pages are faulted in but not locked.\n", strerror(errno));
+        warned = 1;
+    }
+#ifdef MADV_POPULATE_WRITE
+    if (madvise(addr, size, write ? MADV_POPULATE_WRITE : MADV_POPULATE_READ) == 0) {
+        return;
+    }
+#endif
+    size_t page = sysconf(_SC_PAGESIZE);
+    for (size_t offset = 0; offset < size; offset += page) { // touch every page
+        volatile char *p = (char *) addr + offset;
+        if (write) {
+            *p = *p;
+        } else {
+            (void) *p;
+        }
+    }
+}
+
+// function to get the page faults of the calling process, or thread when the group runs as threads
+uint64_t page_faults(void) {
+    struct rusage usage;
+    if (getrusage(threads ? RUSAGE_THREAD : RUSAGE_SELF, &usage) == -1) { // check for errors
+        perror("getrusage");
+        return 0;
+    }
+    return usage.ru_minflt + usage.ru_majflt;
+}
+
+// function to note that the participant in the calling process or thread is set up and about to wait for its first round
+void note_setup_done(void) {
+    setup_done_at = page_faults();
+}
+
+// function to get the page faults of the calling process or thread when it last called note_setup_done
+uint64_t setup_done_faults(void) {
+    return setup_done_at;
+}
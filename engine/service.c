@@ -0,0 +1,180 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+
+#include "smokers.h"
+
+// service time models selected with --smoke
+enum service_model {
+    SERVICE_ZERO, // no smoking time
+    SERVICE_CONST, // constant time slept with clock_nanosleep
+    SERVICE_SPIN, // constant time of CPU-bound work
+    SERVICE_EXP, // exponentially distributed sleep
+    SERVICE_LOGNORMAL, // log-normally distributed sleep
+    SERVICE_TRACE // per-round sleep times read from a file
+};
+
+static enum service_model model = SERVICE_CONST; // selected model
+static double param = 1e9; // constant or mean/median time in nanoseconds
+static double sigma = 1.0; // shape of the log-normal distribution
+static uint64_t *trace; // service times from the trace file
+static size_t trace_len; // number of values in the trace
+static double spins_per_ns; // busy loop iterations per nanosecond, measured once at startup
+static __thread struct rng service_rng; // generator of this process or thread
+
+// function to run the busy loop for the given number of iterations
+static void spin(uint64_t iterations) {
+    for (volatile uint64_t i = 0; i < iterations; i++) {
+    }
+}
+
+// function to measure how many busy loop iterations take one nanosecond
+static void calibrate_spin(void) {
+    uint64_t iterations = 1 << 20;
+    while (1) { // double the loop until it runs long enough to be measured
+        uint64_t start = now_ns();
+        spin(iterations);
+        uint64_t elapsed = now_ns() - start;
+        if (elapsed > 20000000) { // 20 ms
+            spins_per_ns = (double) iterations / elapsed;
+            return;
+        }
+        iterations *= 2;
+    }
+}
+
+// function to read one service time in nanoseconds per line
+static int load_trace(const char *path) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) { // check for errors
+        perror(path);
+        return -1;
+    }
+    size_t capacity = 0;
+    unsigned long long value;
+    while (fscanf(file, "%llu", &value) == 1) { // loop through lines
+        if (trace_len == capacity) { // grow the array
+            capacity = capacity ? capacity * 2 : 1024;
+            uint64_t *bigger = realloc(trace, capacity * sizeof(uint64_t));
+            if (bigger == NULL) {
+                perror("realloc");
+                fclose(file);
+                return -1;
+            }
+            trace = bigger;
+        }
+        trace[trace_len++] = value;
+    }
+    fclose(file);
+    if (trace_len == 0) {
+        fprintf(stderr, "%s: no service times\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+// function to parse --smoke=zero|const:NS|spin:NS|exp:MEAN_NS|lognormal:MEDIAN_NS[:SIGMA]|trace:FILE
+int parse_service_model(const char *spec) {
+    const char *arg = strchr(spec, ':'); // parameter after the model name
+    size_t len = arg ? (size_t) (arg - spec) : strlen(spec);
+    char *end = NULL;
+    if (arg != NULL) {
+        arg++;
+    }
+    if (len == 4 && strncmp(spec, "zero", len) == 0 && arg == NULL) {
+        model = SERVICE_ZERO;
+        return 0;
+    }
+    if (arg == NULL) {
+        return -1;
+    }
+    if (len == 5 && strncmp(spec, "trace", len) == 0) {
+        model = SERVICE_TRACE;
+        return load_trace(arg);
+    }
+    param = strtod(arg, &end);
+    if (end == arg || param < 0) {
+        return -1;
+    }
+    if (len == 5 && strncmp(spec, "const", len) == 0 && *end == '\0') {
+        model = SERVICE_CONST;
+    } else if (len == 4 && strncmp(spec, "spin", len) == 0 && *end == '\0') {
+        model = SERVICE_SPIN;
+        calibrate_spin();
+    } else if (len == 3 && strncmp(spec, "exp", len) == 0 && *end == '\0') {
+        model = SERVICE_EXP;
+    } else if (len == 9 && strncmp(spec, "lognormal", len) == 0 && param > 0) {
+        model = SERVICE_LOGNORMAL;
+        if (*end == ':') { // optional shape
+            sigma = strtod(end + 1, &end);
+        }
+        if (*end != '\0' || sigma < 0) {
+            return -1;
+        }
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+// function to disable smoking unless --smoke was given, used by benchmarks
+void set_service_zero(void) {
+    model = SERVICE_ZERO;
+}
+
+// function to save the selected service time model
+void save_service_model(struct service_settings *saved) {
+    saved->model = model;
+    saved->param = param;
+    saved->sigma = sigma;
+}
+
+// function to select a service time model saved before, a trace stays loaded while other models run
+void restore_service_model(const struct service_settings *saved) {
+    model = saved->model;
+    param = saved->param;
+    sigma = saved->sigma;
+}
+
+// function to seed the random service times of the calling process or thread with --seed and a stream
+void seed_service(uint64_t stream) {
+    rng_seed(&service_rng, seed, stream);
+}
+
+// function to sleep for the given number of nanoseconds
+static void sleep_ns(uint64_t ns) {
+    struct timespec ts = {ns / 1000000000, ns % 1000000000};
+    while (clock_nanosleep(CLOCK_MONOTONIC, 0, &ts, &ts) == EINTR) { // continue after signals
+    }
+}
+
+// function to simulate smoking for the given round
+void smoke(int round) {
+    switch (model) {
+        case SERVICE_ZERO:
+            break;
+        case SERVICE_CONST:
+            sleep_ns((uint64_t) param);
+            break;
+        case SERVICE_SPIN:
+            spin((uint64_t) (param * spins_per_ns));
+            break;
+        case SERVICE_EXP:
+            sleep_ns((uint64_t) (-param * log(1.0 - rng_double(&service_rng))));
+            break;
+        case SERVICE_LOGNORMAL: {
+            // normal variate from the Box-Muller transform
+            double u1 = 1.0 - rng_double(&service_rng);
+            double u2 = rng_double(&service_rng);
+            double normal = sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+            sleep_ns((uint64_t) (param * exp(sigma * normal)));
+            break;
+        }
+        case SERVICE_TRACE:
+            sleep_ns(trace[round % trace_len]);
+            break;
+    }
+}
@@ -0,0 +1,116 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "smokers.h"
+
+// function to prepare the state of smoker index of a table
+void smoker_init(struct smoker_state *state, struct shared_mem *mem, int index) {
+    state->mem = mem;
+    state->index = index;
+    state->box = mem_mailbox(mem, index); // only this smoker reads from it
+    state->ring = mailbox_ring(mem, state->box);
+    state->trace = mem_trace(mem, index);
+    state->item = state->box->item; // item this smoker has
+    atomic_store(&state->box->wait.idle_since_ns, now_ns()); // the first wait starts now
+}
+
+// function to hand the table back to the agent for the delivery number taken, so it may publish another round,
+// released counts the post at once, so a smoker killed before it still holds the token in the eyes of the supervisor
+// a round delivered again after its first smoker died may have been released already with --release=pickup
+static void release_table(struct shared_mem *mem, struct mailbox *box, const struct delivery *delivery, uint64_t taken) {
+    if (atomic_load_explicit(&box->released, memory_order_relaxed) > taken) {
+        return;
+    }
+    if (bench) {
+        atomic_store(&mem->release_posted_ns, delivery->posted_ns);
+        atomic_store(&mem->release_ns, now_ns());
+    }
+    if (backend->post(AGENT_SEM(mem)) == -1) { // signal the agent semaphore
+        exit(1);
+    }
+    atomic_store(&box->released, taken + 1);
+}
+
+// function to serve one post of the smoker semaphore, returns 0 once the agent has finished,
+// 1 after a round and 2 after a post which delivered nothing
+// with --release=pickup the table is handed back as soon as the items are taken and smoking overlaps the next rounds
+int smoker_serve(struct smoker_state *state) {
+    struct shared_mem *mem = state->mem;
+    struct mailbox *box = state->box;
+    uint64_t wake_ns = now_ns();
+    trace_step(state->trace, TR_WAKE, 0, 0);
+    uint64_t taken = atomic_load_explicit(&box->taken, memory_order_relaxed);
+    if (mem->done && atomic_load(&box->released) <= taken) { // agent has finished and no round is delivered again
+        return 0;
+    }
+    if (atomic_load(&box->state) == SLOT_RETIRED && taken == box->retire_at) { // wake-up after the last delivery
+        return 0;
+    }
+    if (atomic_load_explicit(&state->ring[taken % mem->depth].seq, memory_order_acquire) < taken) {
+        return 2; // a post left behind by a smoker which died in this slot, nothing was delivered
+    }
+    // the round is in flight from here, a respawned smoker continues at the next delivery
+    atomic_store_explicit(&box->taken, taken + 1, memory_order_relaxed);
+    atomic_store_explicit(&box->heartbeat_ns, wake_ns, memory_order_relaxed);
+    struct delivery delivery = state->ring[taken % mem->depth]; // take every item of the oldest round at once
+    trace_step(state->trace, TR_TAKE, delivery.round, 0);
+    wait_record(&box->wait, wake_ns - atomic_load_explicit(&box->wait.idle_since_ns, memory_order_relaxed));
+    if (bench) {
+        uint64_t take_ns = now_ns();
+        hist_record(&mem->hist[LAT_WAKE], wake_ns - delivery.posted_ns);
+        hist_record(&mem->hist[LAT_PICKUP], take_ns - wake_ns);
+    }
+    log_event(LOG_ALL, EV_TAKE, mem->index, state->index, state->item, delivery.table);
+    if (release_at_pickup) {
+        release_table(mem, box, &delivery, taken);
+        trace_step(state->trace, TR_POST, delivery.round, 0);
+    }
+    trace_step(state->trace, TR_SMOKE_BEGIN, delivery.round, 0);
+    smoke(delivery.round); // simulate smoking time
+    trace_step(state->trace, TR_SMOKE_END, delivery.round, 0);
+    uint64_t served = atomic_load_explicit(&box->served, memory_order_relaxed);
+    atomic_store_explicit(&box->served, served + 1, memory_order_relaxed); // only the owner writes it
+    if (served == 0 && atomic_load_explicit(&mem->first_round_ns, memory_order_relaxed) == 0) { // startup time
+        uint64_t expected = 0;
+        atomic_compare_exchange_strong(&mem->first_round_ns, &expected, now_ns());
+    }
+    atomic_store_explicit(&box->wait.idle_since_ns, now_ns(), memory_order_relaxed); // the next wait starts now
+    if (pull) { // the agent may give this smoker its next round as soon as it wakes
+        mark_ready(mem, state->index);
+    }
+    if (!release_at_pickup) {
+        release_table(mem, box, &delivery, taken);
+        trace_step(state->trace, TR_POST, delivery.round, 0);
+    }
+    return 1;
+}
+
+// function to tell the agent that a smoker which has just started is idle, only with --pull
+// the bit is set before the post, so the agent never wakes for a smoker it cannot see yet
+void smoker_start(struct smoker_state *state) {
+    if (!pull) {
+        return;
+    }
+    mark_ready(state->mem, state->index);
+    if (backend->post(AGENT_SEM(state->mem)) == -1) {
+        exit(1);
+    }
+}
+
+// function to simulate the smoker process
+void smoker(struct shared_mem *mem, int index) {
+    struct smoker_state state;
+    smoker_init(&state, mem, index);
+    atomic_store(&state.box->owner, getpid());
+    seed_service(STREAM_SMOKER(mem->index, index)); // random service times differ between smokers
+    smoker_start(&state);
+    note_setup_done();
+    do {
+        trace_step(state.trace, TR_WAIT, 0, 0);
+        if (sync_wait(SMOKER_SEM(mem, index)) == -1) { // wait for smoker semaphore
+            exit(1);
+        }
+    } while (smoker_serve(&state));
+    spin_flush(&mem->spin);
+}
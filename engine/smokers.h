@@ -0,0 +1,726 @@
+#ifndef SMOKERS_H
+#define SMOKERS_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+#define SMOKERS 3 // default number of smokers
+#define ITEMS 3 // default number of items
+#define MAX_SMOKERS 4096 // maximum number of smokers
+#define MAX_ITEMS 64 // maximum number of items, the table is a 64-bit mask
+#define MAX_ROUNDS 10 // default maximum number of rounds
+#define MAX_DEPTH 64 // maximum number of rounds in flight per table
+#define MAX_TABLES 1024 // maximum number of independent tables
+#define NSEMS (nsmokers + 1) // number of semaphores per table
+#define SMOKER_SEM(mem, i) ((mem)->sem_base + (i)) // semaphore of smoker i of a table
+#define AGENT_SEM(mem) ((mem)->sem_base + (mem)->smokers) // semaphore of the agent of a table
+#define HIST_SUB_BITS 3 // each power of two is split into 2^HIST_SUB_BITS buckets
+#define HIST_BUCKETS 512 // enough buckets for any 64-bit nanosecond value
+#define PERF_EVENTS 2 // number of hardware events counted by benchmarks
+#define LOG_CAPACITY 65536 // number of records in the event log
+#define WAIT_SUB_BITS 2 // each power of two of smoker wait times is split into 2^WAIT_SUB_BITS buckets
+#define WAIT_BUCKETS 180 // buckets of smoker wait times, the last one holds everything above about 2^45 ns
+#define MAX_WEIGHTS 64 // maximum number of values given with --weights
+#define RNG_BATCH 256 // missing items the agent draws at once
+#define TRACE_CAPACITY 8192 // records per trace buffer, later records are counted and dropped
+#define STREAM_SMOKER(table, i) ((1ULL << 32) + (uint64_t) (table) * MAX_SMOKERS + (i)) // service times of a smoker
+#define STREAM_WORKER(id) ((2ULL << 32) + (id)) // service times of a smoker worker
+
+// enum for items
+enum item {
+    TOBACCO = 0,
+    PAPER = 1,
+    MATCH = 2
+};
+
+#define CACHE_LINE 64 // size of a cache line in bytes
+#define SEGMENT_MAGIC 0x315352454b4f4d53ULL // "SMOKERS1" at the start of a segment
+#define SEGMENT_VERSION 7 // layout version of struct shared_mem, bumped on incompatible changes
+#define SPIN_ADAPTIVE -1 // --spin=adaptive
+#define SPIN_MIN 16 // smallest adaptive spin budget in iterations
+#define SPIN_MAX 65536 // largest spin budget in iterations
+
+// placement of the per-smoker state selected with --layout
+enum layout {
+    LAYOUT_PACKED, // mailboxes and semaphores follow each other without padding
+    LAYOUT_MAILBOX // every mailbox and semaphore starts on its own cache line
+};
+
+// state of a PCG32 generator, every agent and smoker owns one so no lock is shared
+struct rng {
+    uint64_t state; // advanced by every draw
+    uint64_t inc; // odd increment which selects the stream
+};
+
+// one round delivered to a smoker, written by the agent only
+struct delivery {
+    uint64_t table; // bitmask of items on the table
+    uint64_t posted_ns; // time when the agent posted the smoker
+    int round; // number of the round, selects the service time from a trace
+    _Atomic uint64_t seq; // number of the delivery in its mailbox, stored last so a post without one is told apart
+};
+
+// state of a smoker slot, smokers launched with --role=smoker join and leave while the agent runs
+enum slot_state {
+    SLOT_FREE, // no smoker, the agent never routes to it
+    SLOT_JOINING, // claimed by a smoker which is not ready yet
+    SLOT_ACTIVE, // the agent routes rounds of the item of the slot to it
+    SLOT_LEAVING, // the smoker asked to leave, set by the smoker
+    SLOT_RETIRED, // the agent stopped routing to it, the smoker leaves after taking retire_at deliveries
+    SLOT_DEAD // the smoker exited without leaving, the agent hands back what it held and frees the slot
+};
+
+// time smokers waited for their items between rounds, written by the owner of a mailbox only
+struct wait_stats {
+    _Atomic uint64_t idle_since_ns; // time the smoker finished its last round or started, read by the agent
+    uint64_t count; // number of waits
+    uint64_t sum_ns; // total time waited
+    uint64_t max_ns; // longest wait
+    uint32_t buckets[WAIT_BUCKETS]; // log-bucketed like latency histograms, with fewer buckets per power of two
+};
+
+// mailbox owned by one smoker, its ring of depth deliveries follows at ring_offset
+// a round is in flight while taken > served + returned, the supervisor delivers it again if the owner dies
+// the agent token of a round is held while taken > released, so the supervisor knows which ones to post back
+struct mailbox {
+    _Atomic uint64_t served; // rounds smoked, written by the owner only
+    _Atomic uint64_t taken; // deliveries taken from the ring, the next one is at taken % depth
+    _Atomic uint64_t released; // rounds whose agent token was posted back, stored right after each post
+    _Atomic uint64_t returned; // rounds handed back to the agent after their smoker died without smoking them
+    _Atomic uint64_t heartbeat_ns; // time of the last round the owner started
+    _Atomic int32_t owner; // pid of the process serving the mailbox
+    _Atomic uint32_t generation; // number of times the smoker was respawned
+    _Atomic int state; // enum slot_state
+    int item; // item the smoker of the slot has
+    uint64_t retire_at; // deliveries posted to the slot before it was retired
+    int weight; // share of rounds of the smoker under the weighted and edf policies
+    struct wait_stats wait; // time between rounds
+};
+
+// log-bucketed latency histogram, updated concurrently by several processes
+struct latency_hist {
+    _Atomic uint64_t count; // number of samples
+    _Atomic uint64_t max; // largest sample in nanoseconds
+    _Atomic uint64_t buckets[HIST_BUCKETS]; // number of samples per bucket
+};
+
+// measured handoff segments
+enum latency_kind {
+    LAT_WAKE, // agent post -> smoker wake
+    LAT_PICKUP, // smoker wake -> items taken from the table
+    LAT_RETURN, // smoker post -> agent wake
+    LAT_ROUND, // agent post -> agent wake after the round
+    LAT_KINDS // number of histograms
+};
+
+// placement of two CPUs compared by the placement benchmark
+enum cpu_distance {
+    CPU_SAME, // one logical CPU
+    CPU_SIBLING, // hyperthreads of one core
+    CPU_SOCKET, // different cores of one socket
+    CPU_CROSS, // different sockets
+    CPU_DISTANCES
+};
+
+// counters of spin-then-block waits, summed over every waiter of a table
+struct spin_stats {
+    _Atomic uint64_t waits; // waits which spun before blocking
+    _Atomic uint64_t hits; // waits satisfied while spinning
+    _Atomic uint64_t spins; // spin iterations of all waits
+};
+
+// struct for shared memory of one table, the variable-size parts follow it at the given offsets
+struct shared_mem {
+    _Atomic uint64_t magic; // SEGMENT_MAGIC once the segment is initialized, checked by processes which attach it
+    uint32_t version; // SEGMENT_VERSION of the process which created the segment
+    int tables; // number of tables in the segment
+    size_t segment_size; // size of the whole segment
+    size_t log_offset; // offset of the event log from the first table, 0 if there is none
+    char backend[16]; // name of the synchronization backend
+    int log_level; // verbosity of the event log
+    int pull; // set with --pull, smokers launched separately follow the agent
+    int pickup; // set with --release=pickup, smokers launched separately follow the agent
+    int index; // number of the table in the segment
+    int sem_base; // index of the first semaphore of this table
+    int smokers; // number of smokers
+    int items; // number of items, the agent puts all but one of them on the table
+    int depth; // rounds the agent may publish ahead of the smokers, also the size of every mailbox ring
+    size_t mailboxes_offset; // mailbox of smoker i starts at mailboxes_offset + i * mailbox_stride
+    size_t mailbox_stride; // distance between mailboxes
+    size_t ring_offset; // offset of the delivery ring inside a mailbox
+    size_t sync_offset; // area owned by the synchronization backend, shared by all tables
+    size_t trace_offset; // trace buffers of the smokers and the agent of this table, 0 without --trace
+    int done; // set by the agent when the smokers must terminate
+    uint64_t finish_ns; // time when the agent finished the last round
+    _Alignas(CACHE_LINE) _Atomic uint64_t release_ns; // time when a smoker last posted the agent
+    _Atomic uint64_t release_posted_ns; // posted_ns of the round released at release_ns
+    struct latency_hist hist[LAT_KINDS]; // latency histograms
+    struct spin_stats spin; // spin-then-block waits of the agent and smokers
+    _Atomic uint64_t setup_faults; // page faults of the agent and smokers while they set themselves up
+    _Atomic uint64_t faults; // page faults of the agent and smokers from their first wait on
+    _Atomic uint32_t generation; // number of smokers of this table respawned by the supervisor
+    _Atomic uint64_t first_round_ns; // time when the first round of this table was smoked
+    _Atomic uint32_t members; // bumped whenever a smoker joins, asks to leave or is found dead
+    _Atomic uint32_t wakeups; // posts of the agent semaphore which carry no round, from the watchdog of --role=agent
+    uint64_t deadline_misses; // rounds delivered after the deadline of the smoker, written by the agent
+    _Alignas(CACHE_LINE) _Atomic uint64_t ready[MAX_SMOKERS / 64]; // with --pull, bit i is set while smoker i is idle
+};
+
+// function to get the mailbox of a smoker
+static inline struct mailbox *mem_mailbox(struct shared_mem *mem, int smoker) {
+    return (struct mailbox *) ((char *) mem + mem->mailboxes_offset + (size_t) smoker * mem->mailbox_stride);
+}
+
+// function to set the bit of an idle smoker in the readiness mask
+static inline void mark_ready(struct shared_mem *mem, int smoker) {
+    atomic_fetch_or(&mem->ready[smoker / 64], 1ULL << (smoker % 64));
+}
+
+// function to clear the bit of a smoker which got a round or left
+static inline void clear_ready(struct shared_mem *mem, int smoker) {
+    atomic_fetch_and(&mem->ready[smoker / 64], ~(1ULL << (smoker % 64)));
+}
+
+// function to get whether a smoker is idle
+static inline int is_ready(struct shared_mem *mem, int smoker) {
+    return (atomic_load_explicit(&mem->ready[smoker / 64], memory_order_acquire) >> (smoker % 64)) & 1;
+}
+
+// function to get the ring of deliveries of a mailbox
+static inline struct delivery *mailbox_ring(struct shared_mem *mem, struct mailbox *box) {
+    return (struct delivery *) ((char *) box + mem->ring_offset);
+}
+
+// function to get the area of the synchronization backend
+static inline void *mem_sync(struct shared_mem *mem) {
+    return (char *) mem + mem->sync_offset;
+}
+
+// steps of a round recorded with --trace
+enum trace_type {
+    TR_WAIT, // about to block on the own semaphore
+    TR_WAKE, // returned from the wait
+    TR_TAKE, // smoker copied its delivery out of the mailbox
+    TR_SMOKE_BEGIN, // smoker starts smoking
+    TR_SMOKE_END, // smoker finished smoking
+    TR_POST // agent posted a smoker (arg is its index) or smoker posted the agent
+};
+
+// one step of a round in a trace buffer
+struct trace_record {
+    uint64_t ns; // CLOCK_MONOTONIC timestamp
+    uint32_t round; // round the step belongs to
+    int32_t tid; // thread which recorded it, the pid of a process
+    uint16_t type; // enum trace_type
+    uint16_t arg; // smoker posted by the agent
+};
+
+// records of one agent or smoker, written only by the process or thread serving it
+struct trace_buffer {
+    _Atomic uint64_t count; // records written, those beyond TRACE_CAPACITY were dropped
+    struct trace_record records[TRACE_CAPACITY];
+};
+
+// function to get the trace buffer of smoker i of a table, or of its agent for i == smokers, NULL without --trace
+static inline struct trace_buffer *mem_trace(struct shared_mem *mem, int i) {
+    return mem->trace_offset ? (struct trace_buffer *) ((char *) mem + mem->trace_offset) + i : NULL;
+}
+
+// verbosity levels selected with --verbose
+enum log_level {
+    LOG_NONE, // no events at all, the hot path does not touch the log
+    LOG_AGENT, // agent events and termination
+    LOG_ALL // every event
+};
+
+// types of events in the log
+enum event_type {
+    EV_PUT, // agent puts items (arg) on a table
+    EV_TAKE, // smoker (actor) with item takes items (arg) and smokes
+    EV_DONE // agent of a table reached the maximum number of rounds
+};
+
+// fixed-size binary record in the event log
+struct event {
+    _Atomic uint64_t seq; // position + 1 once the record is published
+    uint64_t ns; // CLOCK_MONOTONIC timestamp
+    uint64_t arg; // bitmask of items
+    uint32_t actor; // index of the smoker
+    uint8_t type; // enum event_type
+    uint8_t item; // item of the smoker
+    uint16_t table; // number of the table
+};
+
+// multi-producer ring of events in shared memory, drained by one writer process
+struct event_log {
+    int capacity; // number of records, a power of two
+    _Alignas(CACHE_LINE) _Atomic uint64_t head; // next position to reserve, shared by producers
+    _Alignas(CACHE_LINE) _Atomic uint64_t tail; // first position not yet drained by the writer
+    _Atomic int closed; // set when all producers have exited
+    _Alignas(CACHE_LINE) struct event events[];
+};
+
+// results of one run of run_group
+struct run_result {
+    uint64_t cpu_ns; // user and system CPU time of agent and smokers
+    uint64_t startup_ns; // time from the start of the group to the first round smoked on any table
+    uint64_t spin_waits; // waits which spun before blocking
+    uint64_t spin_hits; // waits satisfied while spinning
+    uint64_t rounds; // rounds completed on all tables
+    double fairness; // Jain's index of rounds per unit of weight over all smokers
+    uint64_t wait_p99_max; // largest 99th percentile wait of any smoker
+    uint64_t deadline_misses; // rounds delivered after the deadline of their smoker
+    double rate; // rounds per second
+    long long perf[PERF_EVENTS]; // hardware event counts, -1 if unavailable
+    long context_switches; // voluntary and involuntary context switches of agent and smokers
+    struct latency_hist hist[LAT_KINDS]; // latency histograms merged over all tables
+};
+
+// state of the agent of one table which scheduling policies choose the next smoker from
+struct schedule {
+    struct shared_mem *mem; // table of the agent
+    int **routes; // item -> active smokers which have it
+    int *count; // number of active smokers per item
+    int *turn; // round-robin position among smokers of the same item
+    int *active; // active smokers in slot order
+    int nactive; // number of active smokers
+    int next; // round-robin position in active
+    int *item; // item of every slot, copied out of the mailboxes
+    int *weight; // weight of every slot, copied out of the mailboxes
+    int64_t *credit; // smooth weighted round-robin credit of every slot
+    uint64_t *posted; // deliveries posted per slot, the next goes to posted % depth
+    struct rng rng; // generator of the agent, seeded with --seed and the number of the table
+    uint8_t batch[RNG_BATCH]; // missing items drawn ahead of time
+    int drawn; // items of batch already used
+};
+
+// rule the agent uses to choose which smoker gets the next round
+struct agent_policy {
+    const char *name; // name used with --policy
+    int (*pick)(struct schedule *schedule); // index of the next smoker, -1 if no active smoker is idle with --pull
+};
+
+// benchmark suite selected with --bench=NAME
+struct bench_suite {
+    const char *name; // name used with --bench
+    void (*run)(void); // function running the suite and printing its report
+};
+
+// common wait/post interface implemented by every synchronization backend
+struct sync_backend {
+    const char *name; // name used with --backend
+    const char *variants; // homework variants which use this primitive
+    size_t (*area_size)(int nsems); // bytes the backend needs in shared memory
+    int (*create)(void *area, int nsems); // create nsems semaphores with initial value 0
+    int (*attach)(void *area, int nsems); // make the semaphores usable in the calling process
+    int (*wait)(int sem); // decrement a semaphore, blocking while it is 0
+    int (*post)(int sem); // increment a semaphore
+    int (*post_batch)(const int *sems, int count, int value); // optional, add value to count semaphores in one call
+    int (*wait_batch)(int sem, int value); // optional, subtract value from a semaphore in one call
+    int (*wait_fd)(int sem); // optional, descriptor which polls readable while the semaphore is positive
+    int (*try_wait)(int sem); // optional, decrement without blocking, returns 1 if decremented, 0 if not, -1 on error
+    int cheap_try_wait; // set if try_wait stays in user space, so waits may spin on it before blocking
+    int (*value)(int sem); // optional, current value of a semaphore read without changing it, -1 on error
+    int (*recover)(int sem); // optional, repair a semaphore whose only waiter was killed, -1 if it cannot be
+    void (*report)(int rounds); // optional, print backend statistics at exit
+    void (*destroy)(void); // remove the semaphores from the system
+};
+
+// backends
+extern const struct sync_backend posix_unnamed_backend; // sem_init in shared memory (mod_4)
+extern const struct sync_backend posix_named_backend; // sem_open (mod_5, mod_8)
+extern const struct sync_backend sysv_backend; // semget/semop (mod_6, mod_7)
+extern const struct sync_backend futex_backend; // futex words in shared memory
+extern const struct sync_backend condvar_backend; // mutex and condition variable per semaphore
+extern const struct sync_backend eventfd_backend; // eventfd per semaphore, pollable with epoll
+
+// table of all available backends
+extern const struct sync_backend *const backends[];
+extern const int nbackends;
+
+// backend selected with --backend
+extern const struct sync_backend *backend;
+
+// maximum number of rounds selected with --rounds
+extern int max_rounds;
+
+// number of smokers and items selected with --smokers and --items
+extern int nsmokers;
+extern int nitems;
+
+// number of independent tables selected with --tables
+extern int ntables;
+
+// number of rounds in flight selected with --depth
+extern int depth;
+
+// placement of the per-smoker state selected with --layout
+extern int layout;
+
+// spin budget selected with --spin: 0 blocks at once, SPIN_ADAPTIVE tunes it, N spins N times
+extern int spin_limit;
+
+// set by --threads: agent and smokers are threads of one process and use process-private primitives
+extern int threads;
+
+// CPUs selected with --cpus, agent and smokers take them in turn
+extern int cpu_list[];
+extern int ncpus;
+
+// NUMA node selected with --numa-node, -1 leaves placement to the kernel
+extern int numa_node;
+
+// set by --hugepages and --prefault
+extern int hugepages;
+extern int prefault;
+
+// name of the shared object selected with --shm, NULL keeps the segment anonymous
+extern const char *segment_name;
+
+// set when the current segment is backed by huge pages, and when it is locked in memory
+extern int segment_huge;
+extern int segment_locked;
+
+// number of smoker workers selected with --workers, 0 runs one process or thread per smoker
+extern int workers;
+
+// table of all scheduling policies
+extern const struct agent_policy *const policies[];
+extern const int npolicies;
+
+// scheduling policy selected with --policy
+extern const struct agent_policy *policy;
+
+// set by --release=pickup: smokers hand the table back when they take the items instead of after smoking
+extern int release_at_pickup;
+
+// set by --pull: smokers advertise when they are idle and the agent gives rounds only to idle smokers
+extern int pull;
+
+// weights selected with --weights, smoker i gets weights[i % nweights], 1 if none were given
+extern int weights[];
+extern int nweights;
+
+// seed of every generator selected with --seed, fixed in benchmarks unless given
+extern uint64_t seed;
+
+// relative deadline selected with --deadline, a smoker of weight w must be served within deadline_ns / w
+extern uint64_t deadline_ns;
+extern int deadline_set;
+
+// function to get the distance between semaphores of the given size for the selected layout
+static inline size_t sem_stride(size_t size) {
+    return layout == LAYOUT_MAILBOX ? (size + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE : size;
+}
+
+// benchmark mode selected with --bench: no printing and no smoking time
+extern int bench;
+
+// verbosity selected with --verbose
+extern int verbosity;
+
+// event ring in shared memory, NULL when verbosity is LOG_NONE
+extern struct event_log *event_log;
+
+// set when --backend, --layout, --rounds or --smoke were given explicitly
+extern int backend_set;
+extern int layout_set;
+extern int rounds_set;
+extern int smoke_set;
+
+// function to find a backend by name, returns NULL if there is none
+const struct sync_backend *find_backend(const char *name);
+
+// function to print the names of all backends separated by '|'
+void print_backend_names(void);
+
+// function to wait for a semaphore, spinning on it first if --spin is set and the backend allows it
+int sync_wait(int sem);
+
+// function to add the spin counters of the calling process or thread to stats
+void spin_flush(struct spin_stats *stats);
+
+// function to add value to count semaphores, in one call if the backend supports batches
+int sync_post_batch(const int *sems, int count, int value);
+
+// function to subtract value from a semaphore, in one call if the backend supports batches
+int sync_wait_batch(int sem, int value);
+
+// function to get the current time of the monotonic clock in nanoseconds
+uint64_t now_ns(void);
+
+// function to add a sample to a histogram
+void hist_record(struct latency_hist *hist, uint64_t ns);
+
+// function to get the value below which the given fraction of samples lies
+uint64_t hist_percentile(struct latency_hist *hist, double fraction);
+
+// function to print the header of the latency table
+void print_latency_header(void);
+
+// function to add the samples of one histogram to another
+void hist_merge(struct latency_hist *dst, struct latency_hist *src);
+
+// function to print one line of percentiles per histogram
+void print_latency(const char *label, struct latency_hist hist[LAT_KINDS]);
+
+// function to start counting hardware events in the calling process and every child forked after this call
+void perf_start(void);
+
+// function to stop counting, values are -1 for events which could not be counted
+void perf_stop(long long values[PERF_EVENTS]);
+
+// function to print counted events per round
+void perf_print(const char *label, long long values[PERF_EVENTS], uint64_t rounds);
+
+// function to run ntables independent groups of an agent and smokers, fills result if it is not NULL
+void run_group(struct run_result *result);
+
+// function to find a benchmark suite by name, returns NULL if there is none
+const struct bench_suite *find_bench(const char *name);
+
+// function to compare the IPC primitives with ping-pong and fan-out between processes, printed as JSON
+void bench_ipc(void);
+
+// function to print the names of all benchmark suites separated by '|'
+void print_bench_names(void);
+
+// function to run the same workload for depth 1, 2, 4, ..., max and print rounds/sec against depth
+void run_depth_sweep(int max);
+
+// function to get the context switches and CPU time of the group so far: its threads, or its reaped children
+void group_usage(long *switches, uint64_t *cpu_ns);
+
+// function to parse --smoke=zero|const:NS|spin:NS|exp:MEAN_NS|lognormal:MEDIAN_NS[:SIGMA]|trace:FILE
+int parse_service_model(const char *spec);
+
+// function to disable smoking unless --smoke was given, used by benchmarks
+void set_service_zero(void);
+
+// service time model selected with --smoke, saved by benchmarks which switch to their own and restored after them
+struct service_settings {
+    int model; // model of service.c
+    double param; // constant or mean/median time in nanoseconds
+    double sigma; // shape of the log-normal distribution
+};
+
+// function to save the selected service time model
+void save_service_model(struct service_settings *saved);
+
+// function to select a service time model saved before, a trace stays loaded while other models run
+void restore_service_model(const struct service_settings *saved);
+
+// function to seed the random service times of the calling process or thread with --seed and a stream
+void seed_service(uint64_t stream);
+
+// function to simulate smoking for the given round
+void smoke(int round);
+
+// function to compute the layout of one table, fills the offsets if mem is not NULL and returns its size
+size_t shared_mem_layout(struct shared_mem *mem, int smokers, int items, int depth);
+
+// function to get the number of rounds completed on a table
+uint64_t table_rounds(struct shared_mem *mem);
+
+// function to allocate the routing table: routes[item][0..count[item]-1] are smokers which have that item
+int **build_routes(int smokers, int items, int *count);
+
+// function to fill the routing table with the active smoker slots of a table
+void update_routes(struct shared_mem *mem, int **routes, int *count);
+
+// function to print the name of the item
+void fprint_item_name(FILE *out, int item);
+
+// function to print the names of all items in a table separated by "and"
+void fprint_items(FILE *out, uint64_t table);
+
+// function to parse an item given by name or number, returns -1 if it is invalid
+int parse_item(const char *name);
+
+// function to get the size of an event ring with the given capacity
+size_t event_log_size(int capacity);
+
+// function to initialize an event ring, capacity must be a power of two
+void event_log_init(struct event_log *log, int capacity);
+
+// function to append an event: reserve a position with one atomic add, fill the record, then publish it
+void log_write(int type, int table, int actor, int item, uint64_t arg);
+
+// function to append a step of a round to a trace buffer
+void trace_write(struct trace_buffer *buffer, int type, uint32_t round, int arg);
+
+// function to record a step of a round with --trace, nothing else is done on the hot path otherwise
+static inline void trace_step(struct trace_buffer *buffer, int type, uint32_t round, int arg) {
+    if (buffer != NULL) {
+        trace_write(buffer, type, round, arg);
+    }
+}
+
+// function to export the trace buffers of every table as Chrome trace-event JSON, returns -1 on errors
+int trace_export(const char *path);
+
+// file selected with --trace, NULL disables tracing
+extern const char *trace_path;
+
+// function to append an event if the verbosity allows it, nothing else is done on the hot path otherwise
+static inline void log_event(int level, int type, int table, int actor, int item, uint64_t arg) {
+    if (verbosity >= level) {
+        log_write(type, table, actor, item, arg);
+    }
+}
+
+// function to render one event as the text the homework variants print
+void log_print(FILE *out, const struct event *event);
+
+// function to run the background writer: render events as text, or store raw records if binary is set
+void log_writer(FILE *out, int binary);
+
+// function to render a file of raw records written with --log-file
+int log_decode(const char *path);
+
+// function to simulate the agent process
+void agent(struct shared_mem *mem);
+
+// function to seed a generator, generators with the same seed and different streams give independent sequences
+void rng_seed(struct rng *rng, uint64_t seed, uint64_t stream);
+
+// function to get the next 32 random bits
+uint32_t rng_next(struct rng *rng);
+
+// function to get a uniform number in [0, range)
+uint32_t rng_bounded(struct rng *rng, uint32_t range);
+
+// function to get a uniform double in [0, 1)
+double rng_double(struct rng *rng);
+
+// function to find a scheduling policy by name, returns NULL if there is none
+const struct agent_policy *find_policy(const char *name);
+
+// function to print the names of all scheduling policies separated by '|'
+void print_policy_names(void);
+
+// function to allocate the schedule of a table, returns -1 on errors
+int schedule_init(struct schedule *schedule, struct shared_mem *mem);
+
+// function to rebuild the schedule from the active smoker slots of its table
+void schedule_update(struct schedule *schedule);
+
+// function to release the schedule of a table
+void schedule_free(struct schedule *schedule);
+
+// function to get the number of rounds posted to the smokers of a table which they have not finished yet
+uint64_t schedule_in_flight(struct schedule *schedule);
+
+// function to check whether the next round of a smoker is delivered after its deadline
+int deadline_missed(struct schedule *schedule, int smoker, uint64_t now);
+
+// function to add one wait between rounds to the statistics of a smoker
+void wait_record(struct wait_stats *wait, uint64_t ns);
+
+// function to get the wait below which the given fraction of waits of a smoker lies (upper bound of its bucket)
+uint64_t wait_percentile(const struct wait_stats *wait, double fraction);
+
+// function to print rounds and waits per smoker and Jain's fairness index, fills the fairness fields of result
+void print_fairness(struct run_result *result);
+
+// state of one logical smoker between posts of its semaphore
+struct smoker_state {
+    struct shared_mem *mem; // table of the smoker
+    struct mailbox *box; // mailbox of the smoker
+    struct delivery *ring; // delivery ring in the mailbox
+    struct trace_buffer *trace; // trace buffer of the smoker, NULL without --trace
+    int index; // index of the smoker on its table
+    int item; // item this smoker has
+};
+
+// function to prepare the state of smoker index of a table
+void smoker_init(struct smoker_state *state, struct shared_mem *mem, int index);
+
+// function to serve one post of the smoker semaphore, returns 0 once the agent has finished,
+// 1 after a round and 2 after a post which delivered nothing
+int smoker_serve(struct smoker_state *state);
+
+// function to tell the agent that a smoker which has just started is idle, only with --pull
+void smoker_start(struct smoker_state *state);
+
+// function to simulate the smoker process
+void smoker(struct shared_mem *mem, int index);
+
+// function to get the shared memory of a table
+struct shared_mem *table_at(int index);
+
+// function to map a zero-filled segment shared with children, or private to the process when it runs threads
+// mapped is set to the size to unmap, pages are populated at once if populate is set
+void *map_segment(size_t size, int populate, size_t *mapped);
+
+// function to create a shared object under a temporary name and map it, it is invisible until published
+void *create_named_segment(size_t size, int populate, size_t *mapped);
+
+// function to make the initialized segment visible under segment_name, replacing a stale object atomically
+int publish_segment(void);
+
+// function to map the object published under segment_name with one mmap, NULL if it is missing or incompatible
+// a monitor maps it without writable set, so it cannot disturb the group it watches
+void *attach_segment(size_t *mapped, int writable);
+
+// function to remove the object published under segment_name
+void unlink_segment(void);
+
+// function to fault in every page of the segment in the calling process and lock it there
+// write may be set only before the segment is in use, children touch pages by reading them
+void prefault_segment(void *addr, size_t size, int write);
+
+// function to get the page faults of the calling process, or thread when the group runs as threads
+uint64_t page_faults(void);
+
+// function to note that the participant in the calling process or thread is set up and about to wait for its first round
+void note_setup_done(void);
+
+// function to get the page faults of the calling process or thread when it last called note_setup_done
+uint64_t setup_done_faults(void);
+
+// function to parse a CPU list like "0,2,4-7" into cpus, returns the number of CPUs or -1 on errors
+int parse_cpu_list(const char *spec, int *cpus, int max);
+
+// function to pin the calling process or thread to one CPU
+void pin_to_cpu(int cpu);
+
+// function to find two CPUs this process may use which are placed as kind says, returns -1 if there are none
+int find_cpu_pair(enum cpu_distance kind, int *first, int *second);
+
+// function to bind memory to the NUMA node selected with --numa-node, addr must be page-aligned
+int bind_to_node(void *addr, size_t size);
+
+// function to allocate later memory of the calling process or thread on the selected NUMA node
+void use_node_policy(void);
+
+// function to serve every logical smoker of every table assigned to worker id with epoll
+void worker(int id);
+
+// function to create the segment, tables and semaphores of a group and publish a named segment
+// slots start free if open_slots is set, so smokers launched with --role=smoker can join, returns the page faults taken
+uint64_t create_group(int open_slots);
+
+// function to run the log writer as a thread of the group
+void *log_writer_thread(void *arg);
+
+// set by --role=agent while its watchdog looks for smokers which exited without leaving
+extern int watchdog;
+
+// function to run only the agent of a named segment, smokers launched separately join and leave its slots
+void run_agent_role(void);
+
+// function to join a group started with --role=agent as a smoker which has item,
+// until the agent ends, a signal asks it to leave or it smoked leave_after rounds (0 for no limit)
+int run_smoker_role(int item, int leave_after);
+
+// function to watch a named segment read-only until every agent is done, sampling every monitor_interval_ms
+int run_monitor_role(void);
+
+// interval between samples selected with --interval, and the file selected with --prometheus
+extern int monitor_interval_ms;
+extern const char *prometheus_path;
+
+#endif
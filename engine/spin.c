@@ -0,0 +1,80 @@
+#include <stdio.h>
+
+#include "smokers.h"
+
+// spin budget selected with --spin: 0 blocks at once, SPIN_ADAPTIVE tunes it, N spins N times
+int spin_limit = 0;
+
+static __thread int budget = SPIN_MIN * 4; // current adaptive budget of this waiter
+static __thread double ns_per_spin = 10; // measured cost of one spin iteration
+static __thread int misses; // consecutive waits which ended blocked
+static __thread uint64_t waits, hits, spins; // counters not yet added to the table
+
+// function to tell the CPU that the caller is busy-waiting
+static inline void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ volatile("yield");
+#endif
+}
+
+// function to move the adaptive budget towards twice the handoff latency, in iterations
+static void adapt(double handoff_spins) {
+    double target = 2 * handoff_spins;
+    if (misses >= 4 || target > SPIN_MAX) { // spinning does not pay off, back off
+        budget /= 2;
+    } else {
+        budget += (int) ((target - budget) / 4);
+    }
+    if (budget < SPIN_MIN) {
+        budget = SPIN_MIN;
+    }
+    if (budget > SPIN_MAX) {
+        budget = SPIN_MAX;
+    }
+}
+
+// function to wait for a semaphore, spinning on it first if --spin is set and the backend allows it
+// the semaphore word itself is polled, a post flips it in user space so a spinning waiter sees it without a syscall
+int sync_wait(int sem) {
+    if (spin_limit == 0 || !backend->cheap_try_wait) {
+        return backend->wait(sem);
+    }
+    int taken = backend->try_wait(sem); // a unit posted before the wait is not a spin
+    if (taken != 0) {
+        return taken == 1 ? 0 : -1;
+    }
+    int limit = spin_limit == SPIN_ADAPTIVE ? budget : spin_limit;
+    uint64_t start = now_ns();
+    waits++;
+    for (int i = 0; i < limit; i++) { // loop until the budget is spent
+        cpu_relax();
+        taken = backend->try_wait(sem);
+        if (taken == -1) {
+            return -1;
+        }
+        if (taken) { // handoff arrived while spinning
+            hits++;
+            spins += i + 1;
+            misses = 0;
+            adapt(i + 1);
+            return 0;
+        }
+    }
+    uint64_t spun = now_ns();
+    spins += limit;
+    misses++;
+    ns_per_spin += ((double) (spun - start) / limit - ns_per_spin) / 8;
+    int result = backend->wait(sem);
+    adapt((now_ns() - start) / ns_per_spin); // whole handoff, spinning and blocking
+    return result;
+}
+
+// function to add the spin counters of the calling process or thread to stats
+void spin_flush(struct spin_stats *stats) {
+    atomic_fetch_add(&stats->waits, waits);
+    atomic_fetch_add(&stats->hits, hits);
+    atomic_fetch_add(&stats->spins, spins);
+    waits = hits = spins = 0;
+}
@@ -0,0 +1,184 @@
+#include <stdio.h>
+#include <time.h>
+#include <stdint.h>
+
+#include "smokers.h"
+
+// names of the histograms in the latency table
+static const char *latency_names[LAT_KINDS] = {"wake", "pickup", "return", "round"};
+
+// function to get the current time of the monotonic clock in nanoseconds
+uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// function to get the bucket of a value: exact below 2^bits, then 2^bits buckets per power of two
+static int log_bucket(uint64_t ns, int bits) {
+    if (ns < (1U << bits)) {
+        return (int) ns;
+    }
+    int exp = 63 - __builtin_clzll(ns); // index of the highest set bit
+    int sub = (ns >> (exp - bits)) & ((1 << bits) - 1); // next bits below it
+    return ((exp - bits + 1) << bits) + sub;
+}
+
+// function to get the smallest value which falls into a bucket
+static uint64_t log_bucket_low(int bucket, int bits) {
+    if (bucket < (1 << bits)) {
+        return bucket;
+    }
+    int exp = (bucket >> bits) + bits - 1;
+    uint64_t sub = bucket & ((1 << bits) - 1);
+    return ((1ULL << bits) + sub) << (exp - bits);
+}
+
+// function to get the bucket of a latency sample
+static int hist_bucket(uint64_t ns) {
+    return log_bucket(ns, HIST_SUB_BITS);
+}
+
+// function to get the smallest latency which falls into a bucket
+static uint64_t hist_bucket_low(int bucket) {
+    return log_bucket_low(bucket, HIST_SUB_BITS);
+}
+
+// function to add a sample to a histogram
+void hist_record(struct latency_hist *hist, uint64_t ns) {
+    atomic_fetch_add_explicit(&hist->buckets[hist_bucket(ns)], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&hist->count, 1, memory_order_relaxed);
+    uint64_t max = atomic_load_explicit(&hist->max, memory_order_relaxed);
+    while (ns > max && !atomic_compare_exchange_weak_explicit(&hist->max, &max, ns,
+                                                             memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+// function to get the value below which the given fraction of samples lies (upper bound of its bucket)
+uint64_t hist_percentile(struct latency_hist *hist, double fraction) {
+    uint64_t count = atomic_load(&hist->count);
+    uint64_t rank = (uint64_t) (fraction * count + 0.5); // number of samples to skip
+    uint64_t seen = 0;
+    if (count == 0) {
+        return 0;
+    }
+    for (int i = 0; i < HIST_BUCKETS - 1; i++) { // loop through buckets
+        seen += atomic_load(&hist->buckets[i]);
+        if (seen >= rank && seen > 0) {
+            uint64_t high = hist_bucket_low(i + 1) - 1;
+            uint64_t max = atomic_load(&hist->max);
+            return high < max ? high : max;
+        }
+    }
+    return atomic_load(&hist->max);
+}
+
+// function to add the samples of one histogram to another
+void hist_merge(struct latency_hist *dst, struct latency_hist *src) {
+    for (int i = 0; i < HIST_BUCKETS; i++) { // loop through buckets
+        atomic_fetch_add(&dst->buckets[i], atomic_load(&src->buckets[i]));
+    }
+    atomic_fetch_add(&dst->count, atomic_load(&src->count));
+    if (atomic_load(&src->max) > atomic_load(&dst->max)) {
+        atomic_store(&dst->max, atomic_load(&src->max));
+    }
+}
+
+// function to print the header of the latency table
+void print_latency_header(void) {
+    printf("%-22s %-7s %9s %9s %9s %9s %9s %9s\n",
+           "run", "segment", "samples", "p50 ns", "p90 ns", "p99 ns", "p99.9 ns", "max ns");
+}
+
+// function to print one line of percentiles per histogram
+void print_latency(const char *label, struct latency_hist hist[LAT_KINDS]) {
+    for (int i = 0; i < LAT_KINDS; i++) { // loop through histograms
+        printf("%-22s %-7s %9lu %9lu %9lu %9lu %9lu %9lu\n", label, latency_names[i],
+               (unsigned long) atomic_load(&hist[i].count),
+               (unsigned long) hist_percentile(&hist[i], 0.50),
+               (unsigned long) hist_percentile(&hist[i], 0.90),
+               (unsigned long) hist_percentile(&hist[i], 0.99),
+               (unsigned long) hist_percentile(&hist[i], 0.999),
+               (unsigned long) atomic_load(&hist[i].max));
+    }
+}
+
+// function to add one wait between rounds to the statistics of a smoker
+void wait_record(struct wait_stats *wait, uint64_t ns) {
+    int bucket = log_bucket(ns, WAIT_SUB_BITS);
+    wait->buckets[bucket < WAIT_BUCKETS ? bucket : WAIT_BUCKETS - 1]++;
+    wait->count++;
+    wait->sum_ns += ns;
+    if (ns > wait->max_ns) {
+        wait->max_ns = ns;
+    }
+}
+
+// function to get the wait below which the given fraction of waits of a smoker lies (upper bound of its bucket)
+uint64_t wait_percentile(const struct wait_stats *wait, double fraction) {
+    uint64_t rank = (uint64_t) (fraction * wait->count + 0.5); // number of waits to skip
+    uint64_t seen = 0;
+    for (int i = 0; i < WAIT_BUCKETS - 1; i++) { // loop through buckets
+        seen += wait->buckets[i];
+        if (seen >= rank && seen > 0) {
+            uint64_t high = log_bucket_low(i + 1, WAIT_SUB_BITS) - 1;
+            return high < wait->max_ns ? high : wait->max_ns;
+        }
+    }
+    return wait->max_ns;
+}
+
+// function to print rounds and waits per smoker and Jain's fairness index, fills the fairness fields of result
+// the index is computed over rounds per unit of weight, so it is 1 when every smoker got exactly its share
+void print_fairness(struct run_result *result) {
+    double sum = 0, sum_squares = 0;
+    uint64_t min_rounds = UINT64_MAX, max_rounds_served = 0, worst_p99 = 0, misses = 0;
+    int smokers = 0;
+    int detailed = !bench && ntables * nsmokers <= 16; // one line per smoker only for small groups
+    for (int t = 0; t < ntables; t++) { // loop through tables
+        struct shared_mem *table = table_at(t);
+        misses += table->deadline_misses;
+        for (int i = 0; i < table->smokers; i++) { // loop through smokers
+            struct mailbox *box = mem_mailbox(table, i);
+            uint64_t served = atomic_load(&box->served);
+            if (served == 0 && atomic_load(&box->state) == SLOT_FREE) { // slot which never had a smoker
+                continue;
+            }
+            int weight = box->weight > 0 ? box->weight : 1;
+            double share = (double) served / weight;
+            uint64_t p99 = wait_percentile(&box->wait, 0.99);
+            sum += share;
+            sum_squares += share * share;
+            smokers++;
+            min_rounds = served < min_rounds ? served : min_rounds;
+            max_rounds_served = served > max_rounds_served ? served : max_rounds_served;
+            worst_p99 = p99 > worst_p99 ? p99 : worst_p99;
+            if (detailed) {
+                if (ntables > 1) {
+                    printf("table %d ", t);
+                }
+                printf("smoker %d (", i);
+                fprint_item_name(stdout, box->item);
+                printf(", weight %d): %lu rounds, wait mean %.1f us, p50 %.1f us, p99 %.1f us, max %.1f us.\n",
+                       weight, (unsigned long) served,
+                       box->wait.count ? box->wait.sum_ns / 1e3 / box->wait.count : 0.0,
+                       wait_percentile(&box->wait, 0.50) / 1e3, p99 / 1e3, box->wait.max_ns / 1e3);
+            }
+        }
+    }
+    if (smokers == 0) {
+        return;
+    }
+    double fairness = sum_squares > 0 ? sum * sum / (smokers * sum_squares) : 1.0;
+    printf("fairness (%s policy): Jain's index %.4f over %d smokers, %lu..%lu rounds per smoker, "
+           "worst p99 wait %.1f us.\n", policy->name, fairness, smokers, (unsigned long) min_rounds,
+           (unsigned long) max_rounds_served, worst_p99 / 1e3);
+    if (deadline_set) {
+        printf("deadline: %lu rounds delivered after the deadline of their smoker.\n", (unsigned long) misses);
+    }
+    if (result != NULL) {
+        result->fairness = fairness;
+        result->wait_p99_max = worst_p99;
+        result->deadline_misses = misses;
+    }
+}
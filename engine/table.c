@@ -0,0 +1,130 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "smokers.h"
+
+// function to round a size up to a whole cache line
+static size_t cache_align(size_t size) {
+    return (size + CACHE_LINE - 1) & ~(size_t) (CACHE_LINE - 1);
+}
+
+// function to compute the layout of one table, fills the offsets if mem is not NULL and returns its size
+// with LAYOUT_MAILBOX the agent writes only to the lines of the target smoker, the smoker writes only to its own
+// counter line, so no line is shared by two smokers; LAYOUT_PACKED keeps everything back to back for comparison
+size_t shared_mem_layout(struct shared_mem *mem, int smokers, int items, int depth) {
+    size_t ring = depth * sizeof(struct delivery); // size of one delivery ring
+    size_t mailboxes, ring_offset, stride;
+    if (layout == LAYOUT_MAILBOX) {
+        mailboxes = cache_align(sizeof(struct shared_mem));
+        ring_offset = cache_align(sizeof(struct mailbox)); // counter lines owned by the smoker, then lines written by the agent
+        stride = cache_align(ring_offset + ring);
+    } else {
+        mailboxes = sizeof(struct shared_mem);
+        ring_offset = sizeof(struct mailbox);
+        stride = ring_offset + ring;
+    }
+    if (mem != NULL) {
+        mem->smokers = smokers;
+        mem->items = items;
+        mem->depth = depth;
+        mem->mailboxes_offset = mailboxes;
+        mem->mailbox_stride = stride;
+        mem->ring_offset = ring_offset;
+        for (int i = 0; i < smokers; i++) { // smoker i has item i % items
+            struct mailbox *box = mem_mailbox(mem, i);
+            box->item = i % items;
+            box->weight = 1;
+            atomic_store(&box->state, SLOT_ACTIVE);
+        }
+    }
+    return cache_align(mailboxes + (size_t) smokers * stride); // next table starts here
+}
+
+// function to get the number of rounds completed on a table
+uint64_t table_rounds(struct shared_mem *mem) {
+    uint64_t rounds = 0;
+    for (int i = 0; i < mem->smokers; i++) { // sum the counters of all mailboxes
+        rounds += atomic_load_explicit(&mem_mailbox(mem, i)->served, memory_order_relaxed);
+    }
+    return rounds;
+}
+
+// function to allocate the routing table: routes[item][0..count[item]-1] are smokers which have that item
+// smoker i has item i % items, so every item has at least one smoker when smokers >= items
+int **build_routes(int smokers, int items, int *count) {
+    int **routes = calloc(items, sizeof(int *));
+    if (routes == NULL) {
+        perror("calloc");
+        return NULL;
+    }
+    for (int item = 0; item < items; item++) { // any slot may hold any item
+        count[item] = 0;
+        routes[item] = malloc(smokers * sizeof(int));
+        if (routes[item] == NULL) {
+            perror("malloc");
+            return NULL;
+        }
+    }
+    return routes;
+}
+
+// function to fill the routing table with the active smoker slots of a table
+void update_routes(struct shared_mem *mem, int **routes, int *count) {
+    for (int item = 0; item < mem->items; item++) {
+        count[item] = 0;
+    }
+    for (int i = 0; i < mem->smokers; i++) { // loop through slots
+        struct mailbox *box = mem_mailbox(mem, i);
+        if (atomic_load(&box->state) == SLOT_ACTIVE) {
+            routes[box->item][count[box->item]++] = i;
+        }
+    }
+}
+
+// function to print the name of the item
+void fprint_item_name(FILE *out, int item) {
+    switch (item) {
+        case TOBACCO:
+            fprintf(out, "tobacco");
+            break;
+        case PAPER:
+            fprintf(out, "paper");
+            break;
+        case MATCH:
+            fprintf(out, "match");
+            break;
+        default:
+            fprintf(out, "item %d", item);
+            break;
+    }
+}
+
+// function to print the names of all items in a table separated by "and"
+void fprint_items(FILE *out, uint64_t table) {
+    for (int first = 1; table != 0; first = 0) { // loop through set bits
+        int item = __builtin_ctzll(table);
+        table &= table - 1; // clear the lowest set bit
+        if (!first) {
+            fprintf(out, " and ");
+        }
+        fprint_item_name(out, item);
+    }
+}
+
+// function to parse an item given by name or number, returns -1 if it is invalid
+int parse_item(const char *name) {
+    if (strcmp(name, "tobacco") == 0) {
+        return TOBACCO;
+    } else if (strcmp(name, "paper") == 0) {
+        return PAPER;
+    } else if (strcmp(name, "match") == 0) {
+        return MATCH;
+    }
+    char *end;
+    long item = strtol(name, &end, 10);
+    if (*name == '\0' || *end != '\0' || item < 0 || item >= MAX_ITEMS) {
+        return -1;
+    }
+    return (int) item;
+}
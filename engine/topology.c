@@ -0,0 +1,127 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+
+#include "smokers.h"
+
+// CPUs selected with --cpus, agent and smokers take them in turn
+int cpu_list[CPU_SETSIZE];
+int ncpus = 0;
+
+// NUMA node selected with --numa-node, -1 leaves placement to the kernel
+int numa_node = -1;
+
+// function to parse a CPU list like "0,2,4-7" into cpus, returns the number of CPUs or -1 on errors
+int parse_cpu_list(const char *spec, int *cpus, int max) {
+    int count = 0;
+    const char *p = spec;
+    while (*p != '\0') { // loop through comma-separated ranges
+        char *end;
+        long first = strtol(p, &end, 10);
+        long last = first;
+        if (end == p || first < 0 || first >= CPU_SETSIZE) {
+            return -1;
+        }
+        if (*end == '-') { // range of CPUs
+            p = end + 1;
+            last = strtol(p, &end, 10);
+            if (end == p || last < first || last >= CPU_SETSIZE) {
+                return -1;
+            }
+        }
+        for (long cpu = first; cpu <= last; cpu++) {
+            if (count == max) {
+                return -1;
+            }
+            cpus[count++] = cpu;
+        }
+        if (*end == ',') {
+            end++;
+        } else if (*end != '\0') {
+            return -1;
+        }
+        p = end;
+    }
+    return count;
+}
+
+// function to pin the calling process or thread to one CPU
+void pin_to_cpu(int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) == -1) { // check for errors
+        perror("sched_setaffinity");
+    }
+}
+
+// function to read one number from a topology file of a CPU, returns -1 if it is missing
+static int read_topology(int cpu, const char *name) {
+    char path[128];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/%s", cpu, name);
+    FILE *file = fopen(path, "r");
+    int value = -1;
+    if (file != NULL) {
+        if (fscanf(file, "%d", &value) != 1) {
+            value = -1;
+        }
+        fclose(file);
+    }
+    return value;
+}
+
+// function to find two CPUs this process may use which are placed as kind says, returns -1 if there are none
+int find_cpu_pair(enum cpu_distance kind, int *first, int *second) {
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == -1) { // check for errors
+        perror("sched_getaffinity");
+        return -1;
+    }
+    for (int a = 0; a < CPU_SETSIZE; a++) { // loop through pairs of allowed CPUs
+        if (!CPU_ISSET(a, &allowed)) {
+            continue;
+        }
+        if (kind == CPU_SAME) {
+            *first = *second = a;
+            return 0;
+        }
+        for (int b = a + 1; b < CPU_SETSIZE; b++) {
+            if (!CPU_ISSET(b, &allowed)) {
+                continue;
+            }
+            int same_package = read_topology(a, "physical_package_id") == read_topology(b, "physical_package_id");
+            int same_core = same_package && read_topology(a, "core_id") == read_topology(b, "core_id");
+            if ((kind == CPU_SIBLING && same_core) || (kind == CPU_SOCKET && same_package && !same_core) ||
+                (kind == CPU_CROSS && !same_package)) {
+                *first = a;
+                *second = b;
+                return 0;
+            }
+        }
+    }
+    return -1;
+}
+
+// function to bind memory to the NUMA node selected with --numa-node, addr must be page-aligned
+int bind_to_node(void *addr, size_t size) {
+    unsigned long mask = 1UL << numa_node;
+    if (syscall(SYS_mbind, addr, size, MPOL_BIND, &mask, sizeof(mask) * 8, 0) == -1) { // check for errors
+        perror("mbind");
+        return -1;
+    }
+    return 0;
+}
+
+// function to allocate later memory of the calling process or thread on the selected NUMA node
+void use_node_policy(void) {
+    unsigned long mask = 1UL << numa_node;
+    if (syscall(SYS_set_mempolicy, MPOL_BIND, &mask, sizeof(mask) * 8) == -1) { // check for errors
+        perror("set_mempolicy");
+    }
+}
@@ -0,0 +1,143 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "smokers.h"
+
+static __thread int32_t tid; // id of the calling thread, looked up once
+
+// function to append a step of a round to a trace buffer
+// every buffer has one writer at a time, so a relaxed counter is enough; the exporter runs after writers stop
+// or reads a snapshot in which the newest records may be incomplete
+void trace_write(struct trace_buffer *buffer, int type, uint32_t round, int arg) {
+    if (tid == 0) {
+        tid = (int32_t) syscall(SYS_gettid);
+    }
+    uint64_t count = atomic_load_explicit(&buffer->count, memory_order_relaxed);
+    if (count < TRACE_CAPACITY) {
+        struct trace_record *record = &buffer->records[count];
+        record->ns = now_ns();
+        record->round = round;
+        record->tid = tid;
+        record->type = type;
+        record->arg = arg;
+    }
+    atomic_store_explicit(&buffer->count, count + 1, memory_order_release);
+}
+
+// function to write one complete event spanning [begin, end], with an optional flow id to bind it to another event
+static void write_slice(FILE *out, int *first, const char *name, int32_t pid, int32_t thread, uint64_t begin,
+                        uint64_t end, uint32_t round, const char *flow, uint64_t flow_id) {
+    fprintf(out, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,"
+            "\"args\":{\"round\":%u}", *first ? "" : ",", name, pid, thread, begin / 1e3, (end - begin) / 1e3, round);
+    if (flow != NULL) {
+        fprintf(out, ",\"bind_id\":\"0x%lx\",\"%s\":true", (unsigned long) flow_id, flow);
+    }
+    fprintf(out, "}");
+    *first = 0;
+}
+
+// function to write the name of the track of a thread
+static void write_track_name(FILE *out, int *first, int32_t pid, int32_t thread, int table, int index, int agent) {
+    fprintf(out, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"",
+            *first ? "" : ",", pid, thread);
+    if (agent) {
+        fprintf(out, "agent %d", table);
+    } else if (workers > 0) {
+        fprintf(out, "worker");
+    } else {
+        fprintf(out, "smoker %d.%d", table, index);
+    }
+    fprintf(out, " (%d)\"}}", thread);
+    *first = 0;
+}
+
+// function to convert the records of one buffer into slices: wait, publish or take, and smoke
+// a wait is written once the round it ended in is known, with the take of a smoker or the post of the agent
+static void export_buffer(FILE *out, int *first, struct trace_buffer *buffer, int table, int index, int agent) {
+    uint64_t count = atomic_load_explicit(&buffer->count, memory_order_acquire);
+    uint64_t wait_ns = 0, wake_ns = 0, smoke_ns = 0; // open steps of the current round
+    int32_t thread = 0;
+    for (uint64_t i = 0; i < count && i < TRACE_CAPACITY; i++) { // loop through records
+        struct trace_record *record = &buffer->records[i];
+        int32_t pid = threads ? getpid() : record->tid; // a process has one thread
+        uint64_t flow = (uint64_t) table << 32 | record->round; // links the post of the agent to the take
+        if (record->tid != thread) { // first record, or a respawned smoker
+            thread = record->tid;
+            wait_ns = wake_ns = smoke_ns = 0;
+            write_track_name(out, first, pid, thread, table, index, agent);
+        }
+        switch (record->type) {
+            case TR_WAIT:
+                wait_ns = record->ns;
+                break;
+            case TR_WAKE:
+                wake_ns = record->ns;
+                break;
+            case TR_TAKE:
+                if (wait_ns != 0 && wake_ns != 0) {
+                    write_slice(out, first, "wait", pid, thread, wait_ns, wake_ns, record->round, NULL, 0);
+                }
+                if (wake_ns != 0) {
+                    write_slice(out, first, "take", pid, thread, wake_ns, record->ns, record->round, "flow_in", flow);
+                }
+                wait_ns = wake_ns = 0;
+                break;
+            case TR_SMOKE_BEGIN:
+                smoke_ns = record->ns;
+                break;
+            case TR_SMOKE_END:
+                if (smoke_ns != 0) {
+                    write_slice(out, first, "smoke", pid, thread, smoke_ns, record->ns, record->round, NULL, 0);
+                }
+                smoke_ns = 0;
+                break;
+            case TR_POST:
+                if (!agent) {
+                    write_slice(out, first, "post", pid, thread, record->ns, record->ns, record->round, NULL, 0);
+                    break;
+                }
+                if (wait_ns != 0 && wake_ns != 0) {
+                    write_slice(out, first, "wait", pid, thread, wait_ns, wake_ns, record->round, NULL, 0);
+                }
+                if (wake_ns != 0) { // choosing and delivering the round
+                    write_slice(out, first, "publish", pid, thread, wake_ns, record->ns, record->round, "flow_out", flow);
+                }
+                wait_ns = wake_ns = 0;
+                break;
+        }
+    }
+}
+
+// function to export the trace buffers of every table as Chrome trace-event JSON, returns -1 on errors
+// the file opens in Perfetto or chrome://tracing with one track per agent and smoker
+int trace_export(const char *path) {
+    FILE *out = fopen(path, "w");
+    if (out == NULL) { // check for errors
+        perror(path);
+        return -1;
+    }
+    uint64_t dropped = 0;
+    int first = 1; // no comma before the first event
+    fprintf(out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+    for (int t = 0; t < ntables; t++) { // loop through tables
+        struct shared_mem *table = table_at(t);
+        for (int i = 0; i <= table->smokers; i++) { // smokers, then the agent
+            struct trace_buffer *buffer = mem_trace(table, i);
+            uint64_t count = atomic_load(&buffer->count);
+            dropped += count > TRACE_CAPACITY ? count - TRACE_CAPACITY : 0;
+            export_buffer(out, &first, buffer, t, i, i == table->smokers);
+        }
+    }
+    fprintf(out, "\n]}\n");
+    if (fclose(out) == EOF) {
+        perror(path);
+        return -1;
+    }
+    printf("Trace written to %s%s", path, dropped ? "" : ".\n");
+    if (dropped) {
+        printf(", %lu records dropped after %d per agent or smoker.\n", (unsigned long) dropped, TRACE_CAPACITY);
+    }
+    return 0;
+}
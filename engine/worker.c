@@ -0,0 +1,58 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+
+#include "smokers.h"
+
+#define WORKER_EVENTS 64 // ready descriptors taken from epoll at once
+
+// function to serve every logical smoker of every table assigned to worker id with epoll
+// smoker s of table t is served by worker (t * nsmokers + s) % workers, a post wakes only the worker which owns it
+void worker(int id) {
+    int total = ntables * nsmokers; // logical smokers of all workers
+    int mine = id < total ? (total - 1 - id) / workers + 1 : 0; // logical smokers of this worker
+    struct smoker_state *states = calloc(mine, sizeof(struct smoker_state));
+    int epfd = epoll_create1(0);
+    if (states == NULL || epfd == -1) { // check for errors
+        perror(states == NULL ? "calloc" : "epoll_create1");
+        exit(1);
+    }
+    for (int i = 0; i < mine; i++) { // register the eventfd of every logical smoker
+        int global = id + i * workers;
+        struct shared_mem *table = table_at(global / nsmokers);
+        smoker_init(&states[i], table, global % nsmokers);
+        struct epoll_event event = {.events = EPOLLIN, .data.u32 = i};
+        if (epoll_ctl(epfd, EPOLL_CTL_ADD, backend->wait_fd(SMOKER_SEM(table, global % nsmokers)), &event) == -1) {
+            perror("epoll_ctl");
+            exit(1);
+        }
+    }
+    seed_service(STREAM_WORKER(id)); // random service times differ between workers
+    for (int i = 0; i < mine; i++) { // every logical smoker starts idle
+        smoker_start(&states[i]);
+    }
+    int active = mine; // logical smokers whose agent has not finished
+    note_setup_done();
+    struct epoll_event ready[WORKER_EVENTS];
+    while (active > 0) {
+        int n = epoll_wait(epfd, ready, WORKER_EVENTS, -1);
+        if (n == -1) { // retry if interrupted by a signal
+            continue;
+        }
+        for (int i = 0; i < n; i++) { // loop through ready smokers
+            struct smoker_state *state = &states[ready[i].data.u32];
+            int sem = SMOKER_SEM(state->mem, state->index);
+            int taken = backend->try_wait(sem);
+            if (taken == -1) {
+                exit(1);
+            }
+            if (taken == 1 && !smoker_serve(state)) { // agent has finished, stop watching this smoker
+                epoll_ctl(epfd, EPOLL_CTL_DEL, backend->wait_fd(sem), NULL);
+                active--;
+            }
+        }
+    }
+    close(epfd);
+    free(states);
+}